@@ -7,33 +7,37 @@
 // Windows
 #ifdef _WIN32
 #include <Windows.h>
-static inline double get_cpu_time() {
-    FILETIME a,b,c,d;
-    if (GetProcessTimes(GetCurrentProcess(),&a,&b,&c,&d) != 0){
-        return (double)(d.dwLowDateTime |
-            ((unsigned long long)d.dwHighDateTime << 32)) * 0.0000001;
-    } else {
-        return 0;
-    }
+static inline int64_t get_monotonic_time_ns() {
+    static LARGE_INTEGER frequency = {};
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (int64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
 }
 
 // Posix/Linux
 #else
 #include <time.h>
 #include <sys/time.h>
-static inline double get_cpu_time() {
-    return (double)clock() / CLOCKS_PER_SEC;
+static inline int64_t get_monotonic_time_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
 }
 #endif
 
 namespace checkers {
 
 ///encapsulates a time
+
+///Times are read from a monotonic clock (wall time that never jumps),
+///with nanosecond resolution. They are only meaningful relative to each other.
 class Deadline
 {
 public:
-    ///initializes the time to \p pTime (in microseconds since the epoch)
-    explicit Deadline(double pTime=-1)
+    ///initializes the time to \p pTime (in nanoseconds of the monotonic clock)
+    explicit Deadline(int64_t pTime=-1)
         :   mTime(pTime)
     {
     }
@@ -41,17 +45,10 @@ public:
     ///Times are invalid when they are default-initialised.
     bool isValid() const        {    return mTime!=-1;    }
 
-    ///converts the time to a struct timeval
-    void toTimeval(struct timeval &pTime) const
-    {
-        pTime.tv_sec=((long)(mTime * 1e6))/1000000;
-        pTime.tv_usec=((long)(mTime * 1e6))%1000000;
-    }
-
     ///converts the time from this time to \p pUntil to a struct timeval
     void toTimevalUntil(const Deadline &pUntil,struct timeval &pDiff) const
     {
-        long lDiff=(long)(pUntil.mTime-mTime * 1e6);
+        int64_t lDiff=(pUntil.mTime-mTime)/1000;
         if(lDiff<=0)
         {
             pDiff.tv_sec=0;
@@ -64,14 +61,17 @@ public:
         }
     }
 
-    //Returns a Deadline object representing the CPU time in seconds.
+    //Returns a Deadline object representing the current time.
     static Deadline now()
     {
-        return Deadline(get_cpu_time());
+        return Deadline(get_monotonic_time_ns());
     }
 
     //Returns the value of this deadline in seconds.
-    double getSeconds() const    {    return mTime;    }
+    double getSeconds() const    {    return mTime * 1e-9;    }
+
+    //Returns the value of this deadline in nanoseconds.
+    int64_t getNanoseconds() const    {    return mTime;    }
 
     ///comparison operator
     bool operator<(const Deadline &pOther) const
@@ -112,24 +112,62 @@ public:
     ///adds a delta (in seconds) to this deadline object
     Deadline operator+(double pDelta) const
     {
-        return Deadline(mTime+pDelta);
+        return Deadline(mTime+(int64_t)(pDelta*1e9));
     }
 
     ///subtracts a delta (in seconds) from this deadline object
     Deadline operator-(double pDelta) const
     {
-        return Deadline(mTime-pDelta);
+        return Deadline(mTime-(int64_t)(pDelta*1e9));
     }
 
     ///Subtracts one deadline object from another, returning the 
     ///difference in seconds.
     double operator-(const Deadline &pRH) const
     {
-        return mTime-pRH.mTime;
+        return (mTime-pRH.mTime) * 1e-9;
     }
 
 private:
-    double mTime;
+    int64_t mTime;
+};
+
+///checks a deadline often without reading the clock every time
+
+///expired() can be called once per search node: the clock is only read
+///on every \p pInterval-th call, the other calls just count down.
+class DeadlineCheck
+{
+public:
+    ///checks for \p pDue, reading the clock every \p pInterval calls
+    explicit DeadlineCheck(const Deadline &pDue=Deadline(), unsigned pInterval=1024)
+        :   mDue(pDue)
+        ,   mInterval(pInterval)
+        ,   mCountdown(pInterval)
+        ,   mExpired(false)
+    {
+    }
+
+    ///returns true once the deadline has passed (and from then on)
+    bool expired()
+    {
+        if (mExpired)
+            return true;
+        if (--mCountdown > 0)
+            return false;
+        mCountdown = mInterval;
+        mExpired = (mDue <= Deadline::now());
+        return mExpired;
+    }
+
+    ///returns the deadline being checked
+    const Deadline &getDue() const    {    return mDue;    }
+
+private:
+    Deadline mDue;
+    unsigned mInterval;
+    unsigned mCountdown;
+    bool mExpired;
 };
 
 /*namespace checkers*/ }
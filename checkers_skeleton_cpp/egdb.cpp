@@ -0,0 +1,433 @@
+#include "egdb.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+// Posix/Linux
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace checkers
+{
+
+#ifdef _WIN32
+
+///maps the file \p pPath into memory for reading, returns NULL if it can't be mapped
+static const void *mapFile(const std::string &pPath, std::size_t &pSize)
+{
+    HANDLE lFile = CreateFileA(pPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL, NULL);
+    if (lFile == INVALID_HANDLE_VALUE)
+        return NULL;
+    LARGE_INTEGER lSize;
+    if (!GetFileSizeEx(lFile, &lSize) || lSize.QuadPart == 0)
+    {
+        CloseHandle(lFile);
+        return NULL;
+    }
+    // The view keeps the mapping (and the file) open once the handles are closed
+    HANDLE lMapping = CreateFileMappingA(lFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(lFile);
+    if (!lMapping)
+        return NULL;
+    const void *lView = MapViewOfFile(lMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(lMapping);
+    pSize = (std::size_t)lSize.QuadPart;
+    return lView;
+}
+
+///unmaps a file mapped with mapFile()
+static void unmapFile(const void *pView, std::size_t)
+{
+    UnmapViewOfFile(pView);
+}
+
+// Posix/Linux
+#else
+
+///maps the file \p pPath into memory for reading, returns NULL if it can't be mapped
+static const void *mapFile(const std::string &pPath, std::size_t &pSize)
+{
+    int lFd = ::open(pPath.c_str(), O_RDONLY);
+    if (lFd < 0)
+        return NULL;
+    struct stat lStat;
+    if (fstat(lFd, &lStat) != 0 || lStat.st_size == 0)
+    {
+        ::close(lFd);
+        return NULL;
+    }
+    void *lView = mmap(NULL, lStat.st_size, PROT_READ, MAP_PRIVATE, lFd, 0);
+    ::close(lFd);
+    if (lView == MAP_FAILED)
+        return NULL;
+    pSize = lStat.st_size;
+    return lView;
+}
+
+///unmaps a file mapped with mapFile()
+static void unmapFile(const void *pView, std::size_t pSize)
+{
+    munmap((void *)pView, pSize);
+}
+
+#endif
+
+///binomial coefficients C(n, k), for the combinatorial index
+struct BinomialTable
+{
+    uint64_t mValues[GameState::cSquares + 1][EndgameDatabase::cMaxPieces + 1];
+
+    constexpr BinomialTable()
+        :   mValues()
+    {
+        for (int n = 0; n <= GameState::cSquares; ++n)
+        {
+            mValues[n][0] = 1;
+            for (int k = 1; k <= EndgameDatabase::cMaxPieces && k <= n; ++k)
+                mValues[n][k] = mValues[n - 1][k - 1] + (k < n ? mValues[n - 1][k] : 0);
+        }
+    }
+};
+
+static constexpr BinomialTable cBinomials;
+
+static uint64_t binomial(int pN, int pK)
+{
+    if (pK < 0 || pK > pN)
+        return 0;
+    return cBinomials.mValues[pN][pK];
+}
+
+/*
+ * A slice is indexed group by group: red men, white men, red kings, white
+ * kings. Each group is a combination of the squares left free by the groups
+ * before it, ranked in colexicographic order, so every placement of the
+ * pieces on the 32 squares has its own index and no index is left unused.
+ * Placements with men on their crowning row can't happen in a game; they
+ * are indexed all the same and stored as draws.
+ */
+
+///returns the rank of the squares of \p pGroup among those not in \p pUsed
+static uint64_t rankSquares(uint32_t pGroup, uint32_t pUsed)
+{
+    uint64_t lRank = 0;
+    int i = 0;
+    for (; pGroup; pGroup &= pGroup - 1)
+    {
+        int lSquare = lowestBit(pGroup);
+        int lFree = lSquare - popCount(pUsed & ((1u << lSquare) - 1));
+        lRank += binomial(lFree, ++i);
+    }
+    return lRank;
+}
+
+///returns the \p pCount squares not in \p pUsed with rank \p pRank
+static uint32_t unrankSquares(uint64_t pRank, int pCount, uint32_t pUsed)
+{
+    // Find the free square numbers from the highest, then map them to squares
+    int lFree[EndgameDatabase::cMaxPieces];
+    int lPos = GameState::cSquares - popCount(pUsed);
+    for (int i = pCount; i > 0; --i)
+    {
+        do
+            --lPos;
+        while (binomial(lPos, i) > pRank);
+        pRank -= binomial(lPos, i);
+        lFree[i - 1] = lPos;
+    }
+
+    uint32_t lGroup = 0;
+    int lNext = 0;
+    int lFreeSeen = 0;
+    for (int lSquare = 0; lSquare < GameState::cSquares && lNext < pCount; ++lSquare)
+    {
+        if (pUsed & (1u << lSquare))
+            continue;
+        if (lFreeSeen++ == lFree[lNext])
+        {
+            lGroup |= 1u << lSquare;
+            ++lNext;
+        }
+    }
+    return lGroup;
+}
+
+EndgameDatabase::EndgameDatabase()
+    :   mMaxPieces(0)
+{
+    Slice lEmpty = {NULL, 0, NULL, NULL, 0};
+    int lSide = cMaxPieces + 1;
+    mSlices.assign(lSide * lSide * lSide * lSide, lEmpty);
+}
+
+EndgameDatabase::~EndgameDatabase()
+{
+    close();
+}
+
+int EndgameDatabase::open(const std::string &pDirectory)
+{
+    close();
+
+    int lFound = 0;
+    Material lMaterial;
+    for (lMaterial.mRedMen = 0; lMaterial.mRedMen <= cMaxPieces; ++lMaterial.mRedMen)
+    for (lMaterial.mRedKings = 0; lMaterial.mRedKings <= cMaxPieces; ++lMaterial.mRedKings)
+    for (lMaterial.mWhiteMen = 0; lMaterial.mWhiteMen <= cMaxPieces; ++lMaterial.mWhiteMen)
+    for (lMaterial.mWhiteKings = 0; lMaterial.mWhiteKings <= cMaxPieces; ++lMaterial.mWhiteKings)
+    {
+        if (lMaterial.pieces() > cMaxPieces || lMaterial.mRedMen + lMaterial.mRedKings == 0 ||
+            lMaterial.mWhiteMen + lMaterial.mWhiteKings == 0)
+            continue;
+        if (map(pDirectory + "/" + fileName(lMaterial), lMaterial, mSlices[sliceKey(lMaterial)]))
+        {
+            ++lFound;
+            if (lMaterial.pieces() > mMaxPieces)
+                mMaxPieces = lMaterial.pieces();
+        }
+    }
+    return lFound;
+}
+
+void EndgameDatabase::close()
+{
+    for (std::size_t i = 0; i < mSlices.size(); ++i)
+    {
+        if (mSlices[i].mFile)
+            unmapFile(mSlices[i].mFile, mSlices[i].mFileSize);
+        mSlices[i].mFile = NULL;
+    }
+    mMaxPieces = 0;
+}
+
+EndgameDatabase::Result EndgameDatabase::probe(const GameState &pState) const
+{
+    if (!mMaxPieces || pState.isEOG())
+        return RESULT_UNKNOWN;
+
+    uint32_t lRed = pState.getRedPieces();
+    uint32_t lWhite = pState.getWhitePieces();
+    uint32_t lKings = pState.getKings();
+    if (popCount(lRed | lWhite) > mMaxPieces)
+        return RESULT_UNKNOWN;
+
+    // Slices have red to move, white to move is the same as red to move on the rotated board
+    if (pState.getNextPlayer() == CELL_WHITE)
+    {
+        uint32_t lRotatedRed = GameState::reverseMask(lWhite);
+        lWhite = GameState::reverseMask(lRed);
+        lRed = lRotatedRed;
+        lKings = GameState::reverseMask(lKings);
+    }
+    if (!lRed || !lWhite)
+        return RESULT_UNKNOWN;
+
+    const Slice &lSlice = mSlices[sliceKey(material(lRed, lWhite, lKings))];
+    if (!lSlice.mFile)
+        return RESULT_UNKNOWN;
+    return decode(lSlice.lookup(index(lRed, lWhite, lKings)), pState.getMovesUntilDraw());
+}
+
+EndgameDatabase::Result EndgameDatabase::decode(uint8_t pValue, int pMovesUntilDraw)
+{
+    if (pValue > VALUE_WIN && pValue < VALUE_LOSS && pValue - VALUE_WIN <= pMovesUntilDraw)
+        return RESULT_WIN;
+    if (pValue > VALUE_LOSS && pValue < VALUE_INVALID && pValue - VALUE_LOSS <= pMovesUntilDraw)
+        return RESULT_LOSS;
+    return RESULT_DRAW;
+}
+
+EndgameDatabase::Material EndgameDatabase::material(uint32_t pRed, uint32_t pWhite, uint32_t pKings)
+{
+    Material lMaterial;
+    lMaterial.mRedMen = popCount(pRed & ~pKings);
+    lMaterial.mRedKings = popCount(pRed & pKings);
+    lMaterial.mWhiteMen = popCount(pWhite & ~pKings);
+    lMaterial.mWhiteKings = popCount(pWhite & pKings);
+    return lMaterial;
+}
+
+uint64_t EndgameDatabase::positions(const Material &pMaterial)
+{
+    int lFree = GameState::cSquares;
+    uint64_t lPositions = binomial(lFree, pMaterial.mRedMen);
+    lFree -= pMaterial.mRedMen;
+    lPositions *= binomial(lFree, pMaterial.mWhiteMen);
+    lFree -= pMaterial.mWhiteMen;
+    lPositions *= binomial(lFree, pMaterial.mRedKings);
+    lFree -= pMaterial.mRedKings;
+    return lPositions * binomial(lFree, pMaterial.mWhiteKings);
+}
+
+uint64_t EndgameDatabase::index(uint32_t pRed, uint32_t pWhite, uint32_t pKings)
+{
+    const uint32_t lGroups[4] = {pRed & ~pKings, pWhite & ~pKings, pRed & pKings, pWhite & pKings};
+    uint32_t lUsed = 0;
+    uint64_t lIndex = 0;
+    for (int g = 0; g < 4; ++g)
+    {
+        lIndex = lIndex * binomial(GameState::cSquares - popCount(lUsed), popCount(lGroups[g])) +
+                 rankSquares(lGroups[g], lUsed);
+        lUsed |= lGroups[g];
+    }
+    return lIndex;
+}
+
+void EndgameDatabase::position(const Material &pMaterial, uint64_t pIndex, uint32_t &pRed, uint32_t &pWhite, uint32_t &pKings)
+{
+    const int lCounts[4] = {pMaterial.mRedMen, pMaterial.mWhiteMen, pMaterial.mRedKings, pMaterial.mWhiteKings};
+
+    // Split the index into the ranks of the groups, last group first
+    uint64_t lRadix[4];
+    int lFree = GameState::cSquares;
+    for (int g = 0; g < 4; ++g)
+    {
+        lRadix[g] = binomial(lFree, lCounts[g]);
+        lFree -= lCounts[g];
+    }
+    uint64_t lRanks[4];
+    for (int g = 3; g >= 0; --g)
+    {
+        lRanks[g] = pIndex % lRadix[g];
+        pIndex /= lRadix[g];
+    }
+
+    uint32_t lGroups[4];
+    uint32_t lUsed = 0;
+    for (int g = 0; g < 4; ++g)
+    {
+        lGroups[g] = unrankSquares(lRanks[g], lCounts[g], lUsed);
+        lUsed |= lGroups[g];
+    }
+    pRed = lGroups[0] | lGroups[2];
+    pWhite = lGroups[1] | lGroups[3];
+    pKings = lGroups[2] | lGroups[3];
+}
+
+std::string EndgameDatabase::fileName(const Material &pMaterial)
+{
+    std::string lName = "egdb_";
+    lName += (char)('0' + pMaterial.mRedMen);
+    lName += (char)('0' + pMaterial.mRedKings);
+    lName += (char)('0' + pMaterial.mWhiteMen);
+    lName += (char)('0' + pMaterial.mWhiteKings);
+    return lName + ".bin";
+}
+
+/*
+ * A block is a list of runs, each run two bytes: the value, and the number
+ * of positions with that value less one.
+ */
+bool EndgameDatabase::write(const std::string &pPath, const Material &pMaterial, const uint8_t *pValues)
+{
+    Header lHeader;
+    memcpy(lHeader.mMagic, "CKDB", 4);
+    lHeader.mVersion = 1;
+    lHeader.mMaterial[0] = pMaterial.mRedMen;
+    lHeader.mMaterial[1] = pMaterial.mRedKings;
+    lHeader.mMaterial[2] = pMaterial.mWhiteMen;
+    lHeader.mMaterial[3] = pMaterial.mWhiteKings;
+    lHeader.mBlockSize = cBlockSize;
+    lHeader.mPositions = positions(pMaterial);
+    lHeader.mBlocks = (lHeader.mPositions + cBlockSize - 1) / cBlockSize;
+
+    std::vector<uint64_t> lOffsets;
+    std::vector<uint8_t> lData;
+    lOffsets.reserve(lHeader.mBlocks + 1);
+    for (uint64_t lStart = 0; lStart < lHeader.mPositions; lStart += cBlockSize)
+    {
+        lOffsets.push_back(lData.size());
+        uint64_t lEnd = std::min<uint64_t>(lStart + cBlockSize, lHeader.mPositions);
+        for (uint64_t i = lStart; i < lEnd;)
+        {
+            // Positions the generator found unreachable are stored as draws, they make longer runs
+            uint8_t lValue = (pValues[i] == VALUE_INVALID) ? (uint8_t)VALUE_DRAW : pValues[i];
+            uint64_t lRun = 1;
+            while (i + lRun < lEnd && lRun < 256 &&
+                   ((pValues[i + lRun] == VALUE_INVALID) ? (uint8_t)VALUE_DRAW : pValues[i + lRun]) == lValue)
+                ++lRun;
+            lData.push_back(lValue);
+            lData.push_back(lRun - 1);
+            i += lRun;
+        }
+    }
+    lOffsets.push_back(lData.size());
+
+    std::ofstream lFile(pPath.c_str(), std::ios::binary | std::ios::trunc);
+    lFile.write((const char *)&lHeader, sizeof(lHeader));
+    lFile.write((const char *)&lOffsets[0], lOffsets.size() * sizeof(uint64_t));
+    if (!lData.empty())
+        lFile.write((const char *)&lData[0], lData.size());
+    return lFile.good();
+}
+
+uint8_t EndgameDatabase::Slice::lookup(uint64_t pIndex) const
+{
+    assert(pIndex < mPositions);
+    uint64_t lBlock = pIndex / cBlockSize;
+    uint64_t lLeft = pIndex % cBlockSize;
+    const uint8_t *lRun = mData + mOffsets[lBlock];
+    while (lLeft > lRun[1])
+    {
+        lLeft -= lRun[1] + 1;
+        lRun += 2;
+    }
+    return lRun[0];
+}
+
+int EndgameDatabase::sliceKey(const Material &pMaterial)
+{
+    int lSide = cMaxPieces + 1;
+    return ((pMaterial.mRedMen * lSide + pMaterial.mRedKings) * lSide + pMaterial.mWhiteMen) * lSide +
+           pMaterial.mWhiteKings;
+}
+
+bool EndgameDatabase::map(const std::string &pPath, const Material &pMaterial, Slice &pSlice)
+{
+    std::size_t lSize = 0;
+    const void *lFile = mapFile(pPath, lSize);
+    if (!lFile)
+        return false;
+    if (lSize < sizeof(Header))
+    {
+        unmapFile(lFile, lSize);
+        return false;
+    }
+
+    // Check the file is the slice we expect, and is long enough for its blocks
+    const Header *lHeader = (const Header *)lFile;
+    uint64_t lBlocks = (positions(pMaterial) + cBlockSize - 1) / cBlockSize;
+    const uint64_t *lOffsets = (const uint64_t *)(lHeader + 1);
+    bool lValid = memcmp(lHeader->mMagic, "CKDB", 4) == 0 && lHeader->mVersion == 1 &&
+                  lHeader->mMaterial[0] == pMaterial.mRedMen && lHeader->mMaterial[1] == pMaterial.mRedKings &&
+                  lHeader->mMaterial[2] == pMaterial.mWhiteMen && lHeader->mMaterial[3] == pMaterial.mWhiteKings &&
+                  lHeader->mBlockSize == (uint32_t)cBlockSize && lHeader->mPositions == positions(pMaterial) &&
+                  lHeader->mBlocks == lBlocks &&
+                  sizeof(Header) + (lBlocks + 1) * sizeof(uint64_t) <= lSize;
+    if (lValid)
+        lValid = sizeof(Header) + (lBlocks + 1) * sizeof(uint64_t) + lOffsets[lBlocks] == lSize;
+    if (!lValid)
+    {
+        unmapFile(lFile, lSize);
+        return false;
+    }
+
+    pSlice.mFile = (const uint8_t *)lFile;
+    pSlice.mFileSize = lSize;
+    pSlice.mOffsets = lOffsets;
+    pSlice.mData = (const uint8_t *)(lOffsets + lBlocks + 1);
+    pSlice.mPositions = lHeader->mPositions;
+    return true;
+}
+
+/*namespace checkers*/ }
@@ -0,0 +1,153 @@
+#ifndef _CHECKERS_EGDB_HPP_
+#define _CHECKERS_EGDB_HPP_
+
+#include "gamestate.hpp"
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace checkers
+{
+
+/**
+ * Win/loss/draw databases of the positions with few pieces
+ *
+ * The positions are stored with red to move; a position with white to
+ * move is looked up as its reversed() position. They are split in slices
+ * by the number of red men, red kings, white men and white kings, with
+ * one file per slice, written by tools/egdbgen.cpp.
+ *
+ * A slice holds one value per position. Because the game is drawn when the
+ * moves until draw run out, a value is not just a result but the number of
+ * moves left until draw the result needs: a position valued "win in k"
+ * is won if at least k moves are left, and drawn otherwise.
+ *
+ * Files are block-compressed with run-length coding and mapped into memory
+ * (with mmap, or MapViewOfFile on Windows), so opening them reads nothing:
+ * pages are loaded by the system the first time a probe touches them.
+ */
+class EndgameDatabase
+{
+public:
+    static const int cMaxPieces = 8;        ///< most pieces indexed (the files may have fewer)
+    static const int cBlockSize = 1024;     ///< values per compressed block
+
+    ///values stored for a position
+    enum Value
+    {
+        VALUE_DRAW = 0,         ///< drawn whatever the moves left until draw (also unreachable positions)
+        VALUE_WIN = 0,          ///< VALUE_WIN + k: won with at least k moves left until draw
+        VALUE_LOSS = 64,        ///< VALUE_LOSS + k: lost with at least k moves left until draw
+        VALUE_INVALID = 255     ///< a man on its crowning row, used by the generator only
+    };
+
+    ///results of a probe, for the side to move
+    enum Result
+    {
+        RESULT_UNKNOWN,         ///< the position is not in the database
+        RESULT_WIN,
+        RESULT_LOSS,
+        RESULT_DRAW
+    };
+
+    ///the pieces of a slice, for the side to move (red)
+    struct Material
+    {
+        int mRedMen;
+        int mRedKings;
+        int mWhiteMen;
+        int mWhiteKings;
+
+        ///returns the number of pieces
+        int pieces() const      {    return mRedMen + mRedKings + mWhiteMen + mWhiteKings;    }
+    };
+
+    EndgameDatabase();
+    ~EndgameDatabase();
+
+    /**
+     * Maps the slice files found in \p pDirectory, replacing those mapped before
+     *
+     * \return the number of slices found
+     */
+    int open(const std::string &pDirectory);
+
+    ///unmaps all the slices
+    void close();
+
+    ///returns the largest number of pieces of the mapped slices (0 if none)
+    int getMaxPieces() const    {    return mMaxPieces;    }
+
+    /**
+     * Looks up the result of \p pState for the side to move
+     *
+     * Finished games are not looked up. Safe to call from several threads at once.
+     *
+     * \return RESULT_UNKNOWN if the slice of the position is not mapped
+     */
+    Result probe(const GameState &pState) const;
+
+    ///returns the result of a position valued \p pValue, with \p pMovesUntilDraw moves left until draw
+    static Result decode(uint8_t pValue, int pMovesUntilDraw);
+
+    ///returns the material of the pieces \p pRed, \p pWhite, with red to move
+    static Material material(uint32_t pRed, uint32_t pWhite, uint32_t pKings);
+
+    ///returns the number of positions of a slice (including those with men on their crowning row)
+    static uint64_t positions(const Material &pMaterial);
+
+    ///returns the index of a position with red to move in its slice
+    static uint64_t index(uint32_t pRed, uint32_t pWhite, uint32_t pKings);
+
+    ///finds the position of \p pMaterial with index \p pIndex
+    static void position(const Material &pMaterial, uint64_t pIndex, uint32_t &pRed, uint32_t &pWhite, uint32_t &pKings);
+
+    ///returns the name of the file of a slice, such as "egdb_2101.bin" for 2 red men and a king against a white king
+    static std::string fileName(const Material &pMaterial);
+
+    /**
+     * Compresses the values of a slice and writes them to \p pPath
+     *
+     * \return false if the file could not be written
+     */
+    static bool write(const std::string &pPath, const Material &pMaterial, const uint8_t *pValues);
+
+private:
+    ///the start of a slice file; it is followed by the offsets of the blocks and the blocks
+    struct Header
+    {
+        char mMagic[4];             ///< "CKDB"
+        uint32_t mVersion;
+        uint8_t mMaterial[4];       ///< red men, red kings, white men, white kings
+        uint32_t mBlockSize;
+        uint64_t mPositions;
+        uint64_t mBlocks;
+    };
+
+    ///a mapped slice file
+    struct Slice
+    {
+        const uint8_t *mFile;       ///< the whole file, or NULL if not mapped
+        std::size_t mFileSize;
+        const uint64_t *mOffsets;   ///< mBlocks + 1 offsets of the blocks from mData
+        const uint8_t *mData;
+        uint64_t mPositions;
+
+        ///returns the value of position \p pIndex
+        uint8_t lookup(uint64_t pIndex) const;
+    };
+
+    ///returns the position of \p pMaterial in mSlices
+    static int sliceKey(const Material &pMaterial);
+
+    ///maps one file, returns false if it is missing or not a valid slice file
+    static bool map(const std::string &pPath, const Material &pMaterial, Slice &pSlice);
+
+    std::vector<Slice> mSlices;
+    int mMaxPieces;
+};
+
+/*namespace checkers*/ }
+
+#endif
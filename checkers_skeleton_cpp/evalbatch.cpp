@@ -0,0 +1,135 @@
+#include "evalbatch.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHECKERS_EVALBATCH_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace checkers
+{
+
+void EvalBatch::evaluate()
+{
+    if (usesAVX2())
+        evaluateAVX2();
+    else
+        evaluateScalar();
+}
+
+void EvalBatch::evaluateScalar()
+{
+    for (int i = 0; i < mSize; ++i)
+    {
+        uint32_t lEmpty = ~(mRed[i] | mWhite[i]);
+        uint32_t lRedKings = mRed[i] & mKings[i];
+        uint32_t lWhiteKings = mWhite[i] & mKings[i];
+
+        mMen[i] = popCount(mRed[i] & ~mKings[i]) - popCount(mWhite[i] & ~mKings[i]);
+        mKingCount[i] = popCount(lRedKings) - popCount(lWhiteKings);
+        // Red men move down, white men up, kings both ways
+        mRedMoves[i] = popCount(GameState::shiftDownLeft(mRed[i]) & lEmpty) +
+                       popCount(GameState::shiftDownRight(mRed[i]) & lEmpty) +
+                       popCount(GameState::shiftUpLeft(lRedKings) & lEmpty) +
+                       popCount(GameState::shiftUpRight(lRedKings) & lEmpty);
+        mWhiteMoves[i] = popCount(GameState::shiftUpLeft(mWhite[i]) & lEmpty) +
+                         popCount(GameState::shiftUpRight(mWhite[i]) & lEmpty) +
+                         popCount(GameState::shiftDownLeft(lWhiteKings) & lEmpty) +
+                         popCount(GameState::shiftDownRight(lWhiteKings) & lEmpty);
+    }
+}
+
+#ifdef CHECKERS_EVALBATCH_AVX2
+
+bool EvalBatch::usesAVX2()
+{
+    static const bool sAVX2 = __builtin_cpu_supports("avx2");
+    return sAVX2;
+}
+
+///returns the number of bits set in each 32-bit lane of \p pV
+__attribute__((target("avx2")))
+static inline __m256i popCount8(__m256i pV)
+{
+    // Count the bits of each nibble with a lookup table, then add up the bytes of each lane
+    const __m256i lTable = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lNibble = _mm256_set1_epi8(0x0F);
+    __m256i lLow = _mm256_shuffle_epi8(lTable, _mm256_and_si256(pV, lNibble));
+    __m256i lHigh = _mm256_shuffle_epi8(lTable, _mm256_and_si256(_mm256_srli_epi16(pV, 4), lNibble));
+    __m256i lBytes = _mm256_add_epi8(lLow, lHigh);
+    __m256i lPairs = _mm256_maddubs_epi16(lBytes, _mm256_set1_epi8(1));
+    return _mm256_madd_epi16(lPairs, _mm256_set1_epi16(1));
+}
+
+///returns the number of normal moves of the pieces in \p pDown (moving down) and \p pUp (moving up) in each lane
+__attribute__((target("avx2")))
+static inline __m256i countSteps8(__m256i pDown, __m256i pUp, __m256i pEmpty)
+{
+    // The same shifts as GameState::shiftDownLeft() and friends
+    const __m256i lEvenRows = _mm256_set1_epi32(GameState::cEvenRows);
+    const __m256i lOddRows = _mm256_set1_epi32(GameState::cOddRows);
+    const __m256i lLeftCols = _mm256_set1_epi32(0xE0E0E0E0);
+    const __m256i lRightCols = _mm256_set1_epi32(0x07070707);
+    __m256i lDownLeft = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(pDown, lEvenRows), 4),
+                                        _mm256_slli_epi32(_mm256_and_si256(pDown, lLeftCols), 3));
+    __m256i lDownRight = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(pDown, lRightCols), 5),
+                                         _mm256_slli_epi32(_mm256_and_si256(pDown, lOddRows), 4));
+    __m256i lUpLeft = _mm256_or_si256(_mm256_srli_epi32(_mm256_and_si256(pUp, lEvenRows), 4),
+                                      _mm256_srli_epi32(_mm256_and_si256(pUp, lLeftCols), 5));
+    __m256i lUpRight = _mm256_or_si256(_mm256_srli_epi32(_mm256_and_si256(pUp, lRightCols), 3),
+                                       _mm256_srli_epi32(_mm256_and_si256(pUp, lOddRows), 4));
+    __m256i lDown = _mm256_add_epi32(popCount8(_mm256_and_si256(lDownLeft, pEmpty)),
+                                     popCount8(_mm256_and_si256(lDownRight, pEmpty)));
+    __m256i lUp = _mm256_add_epi32(popCount8(_mm256_and_si256(lUpLeft, pEmpty)),
+                                   popCount8(_mm256_and_si256(lUpRight, pEmpty)));
+    return _mm256_add_epi32(lDown, lUp);
+}
+
+__attribute__((target("avx2")))
+void EvalBatch::evaluateAVX2()
+{
+    // Lanes past mSize are filled with empty boards, so that no uninitialized memory is read (their
+    // results are never read)
+    for (int i = mSize; i < ((mSize + 7) & ~7); ++i)
+    {
+        mRed[i] = 0;
+        mWhite[i] = 0;
+        mKings[i] = 0;
+    }
+
+    for (int i = 0; i < mSize; i += 8)
+    {
+        __m256i lRed = _mm256_load_si256((const __m256i *)&mRed[i]);
+        __m256i lWhite = _mm256_load_si256((const __m256i *)&mWhite[i]);
+        __m256i lKings = _mm256_load_si256((const __m256i *)&mKings[i]);
+        __m256i lEmpty = _mm256_xor_si256(_mm256_or_si256(lRed, lWhite), _mm256_set1_epi32(-1));
+        __m256i lRedKings = _mm256_and_si256(lRed, lKings);
+        __m256i lWhiteKings = _mm256_and_si256(lWhite, lKings);
+
+        __m256i lMen = _mm256_sub_epi32(popCount8(_mm256_andnot_si256(lKings, lRed)),
+                                        popCount8(_mm256_andnot_si256(lKings, lWhite)));
+        __m256i lKingCount = _mm256_sub_epi32(popCount8(lRedKings), popCount8(lWhiteKings));
+
+        // Red men move down, white men up, kings both ways
+        _mm256_store_si256((__m256i *)&mMen[i], lMen);
+        _mm256_store_si256((__m256i *)&mKingCount[i], lKingCount);
+        _mm256_store_si256((__m256i *)&mRedMoves[i], countSteps8(lRed, lRedKings, lEmpty));
+        _mm256_store_si256((__m256i *)&mWhiteMoves[i], countSteps8(lWhiteKings, lWhite, lEmpty));
+    }
+}
+
+#else
+
+bool EvalBatch::usesAVX2()
+{
+    return false;
+}
+
+void EvalBatch::evaluateAVX2()
+{
+    evaluateScalar();
+}
+
+#endif
+
+/*namespace checkers*/ }
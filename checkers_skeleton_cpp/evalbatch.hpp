@@ -0,0 +1,92 @@
+#ifndef _CHECKERS_EVALBATCH_HPP_
+#define _CHECKERS_EVALBATCH_HPP_
+
+#include "gamestate.hpp"
+#include <stdint.h>
+
+namespace checkers
+{
+
+/**
+ * Positions whose evaluation terms are computed together
+ *
+ * The positions are stored as structure of arrays (one array per mask),
+ * so that evaluate() can work on 8 of them at once with AVX2. The terms
+ * are counted from the point of view of red; Player turns them into a
+ * score for the side to move.
+ */
+class EvalBatch
+{
+public:
+    static const int cMaxSize = 16;
+
+    EvalBatch()
+        :   mSize(0)
+    {
+    }
+
+    ///returns the number of positions added since the last clear()
+    int size() const            {    return mSize;    }
+    ///returns true when no more positions can be added
+    bool full() const           {    return mSize == cMaxSize;    }
+    ///removes all the positions
+    void clear()                {    mSize = 0;    }
+
+    ///adds \p pState to the batch, which must not be full, and returns its index
+    int add(const GameState &pState)
+    {
+        assert(mSize < cMaxSize);
+        mRed[mSize] = pState.getRedPieces();
+        mWhite[mSize] = pState.getWhitePieces();
+        mKings[mSize] = pState.getKings();
+        mPieceSquare[mSize] = pState.getPieceSquare();
+        mMovesUntilDraw[mSize] = pState.getMovesUntilDraw();
+        return mSize++;
+    }
+
+    /**
+     * Computes the terms of every position in the batch
+     *
+     * Uses AVX2 if the processor supports it, which is checked once, and
+     * plain code otherwise. Both give the same results.
+     */
+    void evaluate();
+
+    ///computes the terms with plain code
+    void evaluateScalar();
+
+    ///computes the terms with AVX2, which only the machines where usesAVX2() is true can run
+    void evaluateAVX2();
+
+    ///returns true if evaluate() uses AVX2 on this machine
+    static bool usesAVX2();
+
+    ///men of red less men of white
+    int getMen(int i) const             {    return mMen[i];    }
+    ///kings of red less kings of white
+    int getKingCount(int i) const       {    return mKingCount[i];    }
+    ///normal moves red could make, see GameState::countNormalMoves()
+    int getRedMoves(int i) const        {    return mRedMoves[i];    }
+    ///normal moves white could make
+    int getWhiteMoves(int i) const      {    return mWhiteMoves[i];    }
+    ///see GameState::getPieceSquare()
+    int getPieceSquare(int i) const     {    return mPieceSquare[i];    }
+    ///see GameState::getMovesUntilDraw()
+    int getMovesUntilDraw(int i) const  {    return mMovesUntilDraw[i];    }
+
+private:
+    int mSize;
+    alignas(32) uint32_t mRed[cMaxSize];
+    alignas(32) uint32_t mWhite[cMaxSize];
+    alignas(32) uint32_t mKings[cMaxSize];
+    alignas(32) int32_t mMen[cMaxSize];
+    alignas(32) int32_t mKingCount[cMaxSize];
+    alignas(32) int32_t mRedMoves[cMaxSize];
+    alignas(32) int32_t mWhiteMoves[cMaxSize];
+    int32_t mPieceSquare[cMaxSize];
+    uint8_t mMovesUntilDraw[cMaxSize];
+};
+
+/*namespace checkers*/ }
+
+#endif
@@ -0,0 +1,54 @@
+#include "evalcache.hpp"
+#include <cstring>
+
+namespace checkers
+{
+
+EvalCache::EvalCache(std::size_t pEntries)
+    :   mMask(0)
+{
+    resize(pEntries);
+}
+
+void EvalCache::resize(std::size_t pEntries)
+{
+    std::size_t lEntries = 1;
+    while (lEntries * 2 <= pEntries)
+        lEntries *= 2;
+
+    mSlots.reset(new Slot[lEntries]);
+    mMask = lEntries - 1;
+    clear();
+}
+
+void EvalCache::clear()
+{
+    // An empty slot has check 0 and score 0, which only matches key 0
+    for (uint64_t i = 0; i <= mMask; ++i)
+    {
+        mSlots[i].mCheck.store(0, std::memory_order_relaxed);
+        mSlots[i].mScore.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool EvalCache::probe(uint64_t pKey, double &pScore) const
+{
+    const Slot &lSlot = mSlots[pKey & mMask];
+    uint64_t lScore = lSlot.mScore.load(std::memory_order_relaxed);
+    uint64_t lCheck = lSlot.mCheck.load(std::memory_order_relaxed);
+    if ((lCheck ^ lScore) != pKey)
+        return false;
+    memcpy(&pScore, &lScore, sizeof(pScore));
+    return true;
+}
+
+void EvalCache::store(uint64_t pKey, double pScore)
+{
+    uint64_t lScore;
+    memcpy(&lScore, &pScore, sizeof(lScore));
+    Slot &lSlot = mSlots[pKey & mMask];
+    lSlot.mCheck.store(pKey ^ lScore, std::memory_order_relaxed);
+    lSlot.mScore.store(lScore, std::memory_order_relaxed);
+}
+
+/*namespace checkers*/ }
@@ -0,0 +1,62 @@
+#ifndef _CHECKERS_EVALCACHE_HPP_
+#define _CHECKERS_EVALCACHE_HPP_
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace checkers
+{
+
+/**
+ * A small direct-mapped cache of static evaluations
+ *
+ * Each slot holds the score of one position and a tag to recognize it.
+ * New scores simply overwrite the slot, so the cache is lossy. Slots are
+ * atomics, written without locks, so several search threads can share one
+ * cache: the tag is stored xor-ed with the score, and a slot torn by two
+ * concurrent writes fails the check on probe instead of returning a wrong
+ * score. Probes only read the slots; the search threads count their own
+ * probes and hits.
+ */
+class EvalCache
+{
+public:
+    static const std::size_t cDefaultEntries = 1 << 16;
+
+    ///creates a cache with room for \p pEntries scores (rounded down to a power of two)
+    explicit EvalCache(std::size_t pEntries = cDefaultEntries);
+
+    ///changes the size of the cache, clearing it
+    void resize(std::size_t pEntries);
+
+    ///removes all entries
+    void clear();
+
+    /**
+     * Looks up a score
+     *
+     * \param pKey the key of the position (see Player::StaticGameValue)
+     * \param pScore receives the score if found
+     * \return true if the position was found
+     */
+    bool probe(uint64_t pKey, double &pScore) const;
+
+    ///stores \p pScore for the position with key \p pKey
+    void store(uint64_t pKey, double pScore);
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> mCheck;   ///< key xor score bits
+        std::atomic<uint64_t> mScore;   ///< bits of the double score
+    };
+
+    std::unique_ptr<Slot[]> mSlots;
+    uint64_t mMask;
+};
+
+/*namespace checkers*/ }
+
+#endif
@@ -12,19 +12,15 @@ namespace checkers
 GameState::GameState()
 {
 	// Initialize the board
-	for(int i=0;i<cPlayerPieces;i++)
-	{
-		mCell[i]=CELL_RED;
-		mCell[cSquares-1-i]=CELL_WHITE;
-	}
-	for(int i=cPlayerPieces;i<cSquares-cPlayerPieces;i++)
-	{
-		mCell[i]=CELL_EMPTY;
-	}
+	mRed = (1u << cPlayerPieces) - 1;
+	mWhite = mRed << (cSquares - cPlayerPieces);
+	mKings = 0;
 	// Initialize move related variables
 	mLastMove = Move(Move::MOVE_BOG);
 	mMovesUntilDraw = cMovesUntilDraw;
 	mNextPlayer = CELL_RED;
+	mHash = computeHash();
+	mPieceSquare = computePieceSquare();
 }
 
 /**
@@ -45,18 +41,21 @@ GameState::GameState(const std::string &pMessage)
 	assert(moves_left >= 0 && moves_left < 256);
 
 	// Parse the board
+	mRed = mWhite = mKings = 0;
+	mHash = 0;
+	mPieceSquare = 0;
 	for (int i = 0; i < cSquares; ++i)
 	{
 		if (board[i] == MESSAGE_SYMBOLS[CELL_EMPTY])
-			mCell[i] = CELL_EMPTY;
+			setAt(i, CELL_EMPTY);
 		else if (board[i] == MESSAGE_SYMBOLS[CELL_RED])
-			mCell[i] = CELL_RED;
+			setAt(i, CELL_RED);
 		else if (board[i] == MESSAGE_SYMBOLS[CELL_WHITE])
-			mCell[i] = CELL_WHITE;
+			setAt(i, CELL_WHITE);
 		else if (board[i] == MESSAGE_SYMBOLS[CELL_RED | CELL_KING])
-			mCell[i] = CELL_RED | CELL_KING;
+			setAt(i, CELL_RED | CELL_KING);
 		else if (board[i] == MESSAGE_SYMBOLS[CELL_WHITE | CELL_KING])
-			mCell[i] = CELL_WHITE | CELL_KING;
+			setAt(i, CELL_WHITE | CELL_KING);
 		else
 			assert("Invalid cell" && false);
 	}
@@ -84,6 +83,34 @@ GameState::GameState(const std::string &pMessage)
 
 	// Set number of moves left until draw
 	mMovesUntilDraw = moves_left;
+
+	if (mNextPlayer == CELL_WHITE)
+		mHash ^= cZobristKeys.mSide;
+	assert(mHash == computeHash());
+	assert(mPieceSquare == computePieceSquare());
+}
+
+/**
+ * Constructs a board from the masks of its pieces
+ *
+ * \param pRed the cells of the red pieces
+ * \param pWhite the cells of the white pieces
+ * \param pKings the cells of the kings of either color
+ * \param pNextPlayer the player to move
+ * \param pMovesUntilDraw the number of moves left until draw
+ */
+GameState::GameState(uint32_t pRed, uint32_t pWhite, uint32_t pKings, uint8_t pNextPlayer, int pMovesUntilDraw)
+{
+	assert(!(pRed & pWhite) && !(pKings & ~(pRed | pWhite)));
+	assert(pMovesUntilDraw >= 0 && pMovesUntilDraw < 256);
+	mRed = pRed;
+	mWhite = pWhite;
+	mKings = pKings;
+	mLastMove = Move(Move::MOVE_BOG);
+	mMovesUntilDraw = pMovesUntilDraw;
+	mNextPlayer = pNextPlayer;
+	mHash = computeHash();
+	mPieceSquare = computePieceSquare();
 }
 
 /**
@@ -96,12 +123,16 @@ GameState::GameState(const std::string &pMessage)
 GameState::GameState(const GameState &pRH,const Move &pMove)
 {
 	// Copy board
-    memcpy(mCell, pRH.mCell, sizeof(mCell));
+    mRed   = pRH.mRed;
+    mWhite = pRH.mWhite;
+    mKings = pRH.mKings;
 
     // Copy move status
     mMovesUntilDraw = pRH.mMovesUntilDraw;
     mNextPlayer     = pRH.mNextPlayer;
     mLastMove       = pRH.mLastMove;
+    mHash           = pRH.mHash;
+    mPieceSquare    = pRH.mPieceSquare;
 
     // Perform move
     doMove(pMove);
@@ -114,131 +145,136 @@ GameState::GameState(const GameState &pRH,const Move &pMove)
 GameState GameState::reversed() const
 {
 	GameState result = *this;
-	for (int i = 0; i < 32; ++i)
-	{
-		if (mCell[31-i] == CELL_EMPTY)
-			result.mCell[i] = CELL_EMPTY;
-		else
-			result.mCell[i] = mCell[31-i] ^ (CELL_RED | CELL_WHITE);
-	}
+	// Rotating the board maps cell i to cell 31-i, which reverses the bits of each mask
+	result.mRed   = reverseMask(mWhite);
+	result.mWhite = reverseMask(mRed);
+	result.mKings = reverseMask(mKings);
     result.mNextPlayer ^= (CELL_RED | CELL_WHITE);
     result.mLastMove = mLastMove.reversed();
+    result.mHash = result.computeHash();
+    result.mPieceSquare = result.computePieceSquare();
     return result;
 }
 
 /**
- * Tries to make a jump from a certain position of the board
+ * Finds all the jump sequences starting from a certain position of the board
  *
- * \param pMoves a vector where the valid moves will be inserted
- * \param pOther the \ref ECell code corresponding to the player who is not making the move
- * \param pR the row of the cell we are moving from
- * \param pC the col
+ * \param pMoves a buffer where the valid moves will be inserted
+ * \param pNumMoves the number of moves in \p pMoves, updated on return
+ * \param pCell the cell of the piece making the jumps
  * \param pKing true if the moving piece is a king
- * \param pBuffer a buffer where the list of jump positions is
- * inserted (for multiple jumps)
- * \param pDepth the number of multiple jumps before this attempt
+ * \return true if at least one jump was found
  */
-bool GameState::tryJump(std::vector<Move> &pMoves, int pR, int pC,
-             bool pKing, uint8_t *pBuffer, int pDepth) const
+bool GameState::tryJump(Move *pMoves, int &pNumMoves, int pCell, bool pKing) const
 {
-    // Remove ourself temporarily
-	uint8_t lOldSelf = at(pR, pC);
-	mutableAt(pR, pC) = CELL_EMPTY;
-
-	pBuffer[pDepth]=rowColToCell(pR,pC);
-
-    bool lFound=false;
-    uint8_t lOther = mNextPlayer ^ (CELL_WHITE|CELL_RED);
-
-    // Try capturing downwards
-    if(mNextPlayer==CELL_RED||pKing)
+    // One frame per cell in the current jump sequence
+    struct Frame
     {
-        // Try capturing left
-        if((at(pR+1,pC-1)&lOther) && at(pR+2,pC-2)==CELL_EMPTY)
-        {
-            lFound=true;
-            uint8_t lOldValue=at(pR+1,pC-1);
-            mutableAt(pR+1,pC-1)=CELL_EMPTY;
-            tryJump(pMoves,pR+2,pC-2,pKing,pBuffer,pDepth+1);
-            mutableAt(pR+1,pC-1)=lOldValue;
-        }
-        // Try capturing right
-        if((at(pR+1,pC+1)&lOther) && at(pR+2,pC+2)==CELL_EMPTY)
-        {
-            lFound=true;
-            uint8_t lOldValue=at(pR+1,pC+1);
-            mutableAt(pR+1,pC+1)=CELL_EMPTY;
-            tryJump(pMoves,pR+2,pC+2,pKing,pBuffer,pDepth+1);
-            mutableAt(pR+1,pC+1)=lOldValue;
-        }
-    }
-    // Try capturing upwards
-    if(mNextPlayer==CELL_WHITE||pKing)
+        uint32_t mOther;    ///< pieces that can still be captured
+        uint32_t mEmpty;    ///< cells that can be landed on
+        int mDir;           ///< next direction to try from this cell
+        bool mFound;        ///< whether a jump was found from this cell
+    };
+    Frame lStack[Move::cMaxLength];
+    uint8_t lPath[Move::cMaxLength];
+
+    int lFirst, lEnd;
+    moveDirections(mNextPlayer, pKing, lFirst, lEnd);
+
+    // The jumping piece leaves its cell, so it may come back to it
+    uint32_t lBit = 1u << pCell;
+    lStack[0].mOther = mRed ^ mWhite ^ getPieces(mNextPlayer);
+    lStack[0].mEmpty = getEmpty() | lBit;
+    lStack[0].mDir = lFirst;
+    lStack[0].mFound = false;
+    lPath[0] = pCell;
+
+    int lDepth = 0;
+    while (lDepth >= 0)
     {
-        // Try capturing left
-        if((at(pR-1,pC-1)&lOther) && at(pR-2,pC-2)==CELL_EMPTY)
+        Frame &lFrame = lStack[lDepth];
+        int lCell = lPath[lDepth];
+
+        // No more directions to try: a sequence ends here if nothing else can be captured
+        if (lFrame.mDir == lEnd)
         {
-            lFound=true;
-            uint8_t lOldValue=at(pR-1,pC-1);
-            mutableAt(pR-1,pC-1)=CELL_EMPTY;
-            tryJump(pMoves,pR-2,pC-2,pKing,pBuffer,pDepth+1);
-            mutableAt(pR-1,pC-1)=lOldValue;
+            if (!lFrame.mFound && lDepth > 0)
+            {
+                assert(pNumMoves < cMaxMoves);
+                pMoves[pNumMoves++] = Move(lPath, lDepth + 1);
+            }
+            --lDepth;
+            continue;
         }
-        // Try capturing right
-        if((at(pR-1,pC+1)&lOther) && at(pR-2,pC+2)==CELL_EMPTY)
+
+        int lDir = lFrame.mDir++;
+        int lLand = jumpLanding(lCell, lDir);
+        if (lLand == cNoCell)
+            continue;
+        uint32_t lOver = 1u << neighbor(lCell, lDir);
+        if ((lFrame.mOther & lOver) && (lFrame.mEmpty & (1u << lLand)))
         {
-            lFound=true;
-            uint8_t lOldValue=at(pR-1,pC+1);
-            mutableAt(pR-1,pC+1)=CELL_EMPTY;
-            tryJump(pMoves,pR-2,pC+2,pKing,pBuffer,pDepth+1);
-            mutableAt(pR-1,pC+1)=lOldValue;
+            // Capture and continue jumping from the landing cell
+            lFrame.mFound = true;
+            assert(lDepth + 1 < Move::cMaxLength);
+            Frame &lNext = lStack[lDepth + 1];
+            lNext.mOther = lFrame.mOther & ~lOver;
+            lNext.mEmpty = lFrame.mEmpty | lOver;
+            lNext.mDir = lFirst;
+            lNext.mFound = false;
+            lPath[++lDepth] = lLand;
         }
     }
 
-    // Restore ourself
-	mutableAt(pR, pC) = lOldSelf;
-
-    if(!lFound&&pDepth>0)
-        pMoves.push_back(Move(pBuffer,pDepth+1));
-
-    return lFound;
+    return lStack[0].mFound;
 }
 
 /**
  * Tries to make a move from a certain position
  *
- * \param pMoves vector where the valid moves will be inserted
+ * \param pMoves buffer where the valid moves will be inserted
+ * \param pNumMoves the number of moves in \p pMoves, updated on return
  * \param pCell the cell where the move is tried from
- * \param pOther the \ref ECell code corresponding to the player
- * who is not making the move
  * \param pKing true if the piece is a king
  */
-void GameState::tryMove(std::vector<Move> &pMoves, int pCell, bool pKing) const
+void GameState::tryMove(Move *pMoves, int &pNumMoves, int pCell, bool pKing) const
 {
-    int lR=cellToRow(pCell);
-    int lC=cellToCol(pCell);
-    // Try moving downwards
-    if(mNextPlayer==CELL_RED||pKing)
-    {
-        // Try moving right
-        if(at(lR+1,lC-1)==CELL_EMPTY)
-            pMoves.push_back(Move(pCell,rowColToCell(lR+1,lC-1)));
-        //try moving left
-        if(at(lR+1,lC+1)==CELL_EMPTY)
-            pMoves.push_back(Move(pCell,rowColToCell(lR+1,lC+1)));
-    }
-    // Try moving upwards
-    if(mNextPlayer==CELL_WHITE||pKing)
+    uint32_t lEmpty = getEmpty();
+    int lFirst, lEnd;
+    moveDirections(mNextPlayer, pKing, lFirst, lEnd);
+
+    // Try moving downwards, then upwards
+    for (int lDir = lFirst; lDir < lEnd; ++lDir)
     {
-        // Try moving right
-        if(at(lR-1,lC-1)==CELL_EMPTY)
-            pMoves.push_back(Move(pCell,rowColToCell(lR-1,lC-1)));
-        // Try moving left
-        if(at(lR-1,lC+1)==CELL_EMPTY)
-            pMoves.push_back(Move(pCell,rowColToCell(lR-1,lC+1)));
+        int lTo = neighbor(pCell, lDir);
+        if (lTo != cNoCell && (lEmpty & (1u << lTo)))
+            pMoves[pNumMoves++] = Move(pCell,lTo);
     }
 }
 
+/**
+ * Returns the mask of pieces of the player to move which can capture something
+ *
+ * Works on all pieces at once: a piece can jump in a direction if the
+ * cell one step away holds an opponent piece and the cell two steps away
+ * is empty, which is the same as shifting the empty cells back twice.
+ */
+uint32_t GameState::findJumpers() const
+{
+    uint32_t lOwn = getPieces(mNextPlayer);
+    uint32_t lOther = mRed ^ mWhite ^ lOwn;
+    uint32_t lEmpty = getEmpty();
+    uint32_t lDown = (mNextPlayer == CELL_RED) ? lOwn : (lOwn & mKings);
+    uint32_t lUp = (mNextPlayer == CELL_WHITE) ? lOwn : (lOwn & mKings);
+
+    uint32_t lJumpers = 0;
+    lJumpers |= lDown & shiftUpRight(shiftUpRight(lEmpty) & lOther);
+    lJumpers |= lDown & shiftUpLeft(shiftUpLeft(lEmpty) & lOther);
+    lJumpers |= lUp & shiftDownRight(shiftDownRight(lEmpty) & lOther);
+    lJumpers |= lUp & shiftDownLeft(shiftDownLeft(lEmpty) & lOther);
+    return lJumpers;
+}
+
 /**
  * Returns a list of all valid moves for \p pWho
  *
@@ -250,53 +286,134 @@ void GameState::findPossibleMoves(std::vector<GameState> &pStates) const
 {
     pStates.clear();
 
+    Move lMoves[cMaxMoves];
+    int lNumMoves = findPossibleMoves(lMoves);
+
+    // Convert moves to GameStates
+    for (int i = 0; i < lNumMoves; ++i)
+    	pStates.push_back(GameState(*this, lMoves[i]));
+}
+
+/**
+ * Writes all valid moves for the player to move into \p pMoves
+ *
+ * \param pMoves a buffer with room for at least cMaxMoves moves
+ * \return the number of moves written
+ */
+int GameState::findPossibleMoves(Move *pMoves) const
+{
     if (mLastMove.isEOG())
-    	return;
+    	return 0;
 
     if (mMovesUntilDraw <= 0)
     {
-    	pStates.push_back(GameState(*this, Move(Move::MOVE_DRAW)));
-    	return;
+    	pMoves[0] = Move(Move::MOVE_DRAW);
+    	return 1;
     }
 
     // Normal moves are forbidden if any jump is found
-    bool lFound=false;
-    int lPieces[cPlayerPieces];
-    uint8_t lMoveBuffer[cPlayerPieces];
-	std::vector<Move> lMoves;
-    int lNumPieces=0;
-    for (int i = 0; i < cSquares; ++i)
-    {
-        // Is this a piece which belongs to the player making the move?
-        if (at(i) & mNextPlayer)
-        {
-            bool lIsKing = at(i)&CELL_KING;
+    int lNumMoves = findCaptures(pMoves);
 
-            if (tryJump(lMoves, cellToRow(i), cellToCol(i), lIsKing, lMoveBuffer))
-                lFound=true;
+    // Try normal moves if no jump was found
+    if (lNumMoves == 0)
+        lNumMoves = findQuietMoves(pMoves);
 
-            lPieces[lNumPieces++]=i;
-        }
+    // Admit loss if no moves can be found
+    if (lNumMoves == 0)
+    	pMoves[lNumMoves++] = Move(mNextPlayer == CELL_WHITE ? Move::MOVE_RW : Move::MOVE_WW);
+
+    return lNumMoves;
+}
+
+/**
+ * Writes all the jump sequences of the player to move into \p pMoves
+ *
+ * \param pMoves a buffer with room for at least cMaxMoves moves
+ * \return the number of moves written
+ */
+int GameState::findCaptures(Move *pMoves) const
+{
+    int lNumMoves = 0;
+    for (uint32_t lJumpers = findJumpers(); lJumpers; lJumpers &= lJumpers - 1)
+    {
+        int lCell = lowestBit(lJumpers);
+        tryJump(pMoves, lNumMoves, lCell, mKings & (1u << lCell));
     }
+    return lNumMoves;
+}
 
-    // Try normal moves if no jump was found
-    if (!lFound)
+/**
+ * Writes all the normal (non-jump) moves of the player to move into \p pMoves
+ *
+ * \param pMoves a buffer with room for at least cMaxMoves moves
+ * \return the number of moves written
+ */
+int GameState::findQuietMoves(Move *pMoves) const
+{
+    int lNumMoves = 0;
+    for (uint32_t lOwn = getPieces(mNextPlayer); lOwn; lOwn &= lOwn - 1)
     {
-        for (int k = 0; k < lNumPieces; ++k)
-        {
-            int lCell = lPieces[k];
-            bool lIsKing = at(lCell) & CELL_KING;
-            tryMove(lMoves, lCell, lIsKing);
-        }
+        int lCell = lowestBit(lOwn);
+        tryMove(pMoves, lNumMoves, lCell, mKings & (1u << lCell));
     }
+    return lNumMoves;
+}
 
-    // Convert moves to GameStates
-    for (unsigned i = 0; i < lMoves.size(); ++i)
-    	pStates.push_back(GameState(*this, lMoves[i]));
+/**
+ * Returns true if \p pMove is one of the jumps or normal moves findPossibleMoves would return
+ */
+bool GameState::isLegal(const Move &pMove) const
+{
+    if (!pMove.isJump() && !pMove.isNormal())
+        return false;
+    if (mLastMove.isEOG() || mMovesUntilDraw <= 0)
+        return false;
 
-    // Admit loss if no moves can be found
-    if (pStates.size() == 0)
-    	pStates.push_back(GameState(*this, Move(mNextPlayer == CELL_WHITE ? Move::MOVE_RW : Move::Move::MOVE_WW)));
+    int lCell = pMove[0];
+    uint32_t lBit = 1u << lCell;
+    uint32_t lOwn = getPieces(mNextPlayer);
+    if (!(lOwn & lBit))
+        return false;
+
+    int lFirst, lEnd;
+    moveDirections(mNextPlayer, mKings & lBit, lFirst, lEnd);
+
+    if (pMove.isNormal())
+    {
+        if (findJumpers() || !(getEmpty() & (1u << pMove[1])))
+            return false;
+        for (int lDir = lFirst; lDir < lEnd; ++lDir)
+            if (neighbor(lCell, lDir) == pMove[1])
+                return true;
+        return false;
+    }
+
+    // Replay the jumps the same way tryJump finds them
+    uint32_t lOther = mRed ^ mWhite ^ lOwn;
+    uint32_t lEmpty = getEmpty() | lBit;
+    for (unsigned i = 1; i < pMove.length(); ++i)
+    {
+        int lDir = lFirst;
+        while (lDir < lEnd && jumpLanding(lCell, lDir) != pMove[i])
+            ++lDir;
+        if (lDir == lEnd)
+            return false;
+        uint32_t lOver = 1u << neighbor(lCell, lDir);
+        if (!(lOther & lOver) || !(lEmpty & (1u << pMove[i])))
+            return false;
+        lOther &= ~lOver;
+        lEmpty |= lOver;
+        lCell = pMove[i];
+    }
+
+    // A jump sequence can't stop while there is something left to capture
+    for (int lDir = lFirst; lDir < lEnd; ++lDir)
+    {
+        int lLand = jumpLanding(lCell, lDir);
+        if (lLand != cNoCell && (lOther & (1u << neighbor(lCell, lDir))) && (lEmpty & (1u << lLand)))
+            return false;
+    }
+    return true;
 }
 
 /**
@@ -308,59 +425,155 @@ void GameState::findPossibleMoves(std::vector<GameState> &pStates) const
  */
 void GameState::doMove(const Move &pMove)
 {
-    if (pMove.isJump())
+    if (pMove.isJump() || pMove.isNormal())
     {
-    	// Row and column of source cell
-        int sr = cellToRow(pMove[0]);
-        int sc = cellToCol(pMove[0]);
+        uint32_t lFrom = 1u << pMove[0];
+        uint32_t lTo = 1u << pMove[pMove.length()-1];
+        uint32_t &lOwn = (mRed & lFrom) ? mRed : mWhite;
+        uint32_t &lOther = (mRed & lFrom) ? mWhite : mRed;
+        uint8_t lOwnColor = (&lOwn == &mRed) ? CELL_RED : CELL_WHITE;
+        uint8_t lOtherColor = lOwnColor ^ (CELL_RED | CELL_WHITE);
+
+        // Move the piece (a king may end a jump on the cell it started from)
+        mHash ^= pieceKey(lOwnColor | ((mKings & lFrom) ? CELL_KING : 0), pMove[0]);
+        mPieceSquare -= pieceSquare(lOwnColor | ((mKings & lFrom) ? CELL_KING : 0), pMove[0]);
+        lOwn = (lOwn & ~lFrom) | lTo;
+        if (mKings & lFrom)
+            mKings = (mKings & ~lFrom) | lTo;
 
-    	// Perform all jumps
-        for(unsigned i=1;i<pMove.length();++i)
-        {
-        	// Destination cell
-            int dr = cellToRow(pMove[i]);
-            int dc = cellToCol(pMove[i]);
+        // Promote to king if we should
+        if (lTo & ((lOwnColor == CELL_RED) ? cRedKingRow : cWhiteKingRow))
+            mKings |= lTo;
+        mHash ^= pieceKey(lOwnColor | ((mKings & lTo) ? CELL_KING : 0), pMove[pMove.length()-1]);
+        mPieceSquare += pieceSquare(lOwnColor | ((mKings & lTo) ? CELL_KING : 0), pMove[pMove.length()-1]);
 
-            // Move the jumping piece
-            at(pMove[i]) = at(pMove[i-1]);
-            at(pMove[i-1]) = CELL_EMPTY;
+        if (pMove.isJump())
+        {
+            // Remove the pieces being jumped over
+            uint32_t lCaptured = 0;
+            for(unsigned i=1;i<pMove.length();++i)
+            {
+                for (int lDir = 0; lDir < DIR_COUNT; ++lDir)
+                {
+                    if (jumpLanding(pMove[i-1], lDir) == pMove[i])
+                        lCaptured |= 1u << neighbor(pMove[i-1], lDir);
+                }
+            }
+            for (uint32_t lLeft = lCaptured; lLeft; lLeft &= lLeft - 1)
+            {
+                int lCell = lowestBit(lLeft);
+                mHash ^= pieceKey(lOtherColor | ((mKings & (1u << lCell)) ? CELL_KING : 0), lCell);
+                mPieceSquare -= pieceSquare(lOtherColor | ((mKings & (1u << lCell)) ? CELL_KING : 0), lCell);
+            }
+            lOther &= ~lCaptured;
+            mKings &= ~lCaptured;
+
+            // Reset number of moves left until draw
+            mMovesUntilDraw = cMovesUntilDraw;
+        }
+        else
+        {
+            // Decrease number of moves left until draw
+            --mMovesUntilDraw;
+        }
+    }
 
-            // Promote to king if we should
-            if ((dr==7 && (at(pMove[i])&CELL_RED)) || (dr==0 && (at(pMove[i])&CELL_WHITE)))
-                at(pMove[i])|=CELL_KING;
+    // Remember last move
+    mLastMove = pMove;
 
-            // Remove the piece being jumped over
-            at(rowColToCell((sr+dr)>>1,(sc+dc)>>1)) = CELL_EMPTY;
+    // Swap player
+    mNextPlayer = mNextPlayer ^ (CELL_RED | CELL_WHITE);
+    mHash ^= cZobristKeys.mSide;
 
-            // Prepare for next jump
-            sr = dr;
-            sc = dc;
-        }
+    assert(mHash == computeHash());
+    assert(mPieceSquare == computePieceSquare());
+}
 
-        // Reset number of moves left until draw
-        mMovesUntilDraw = cMovesUntilDraw;
+/**
+ * Computes the Zobrist key of the position from scratch
+ */
+uint64_t GameState::computeHash() const
+{
+    uint64_t lHash = 0;
+    for (uint32_t lPieces = mRed | mWhite; lPieces; lPieces &= lPieces - 1)
+    {
+        int lCell = lowestBit(lPieces);
+        lHash ^= pieceKey(at(lCell), lCell);
     }
-    else if(pMove.isNormal())
+    if (mNextPlayer == CELL_WHITE)
+        lHash ^= cZobristKeys.mSide;
+    return lHash;
+}
+
+/**
+ * Computes the sum of the piece-square values from scratch
+ */
+int GameState::computePieceSquare() const
+{
+    int lSum = 0;
+    for (uint32_t lPieces = mRed | mWhite; lPieces; lPieces &= lPieces - 1)
     {
-    	// Move the piece
-        at(pMove[1]) = at(pMove[0]);
-        at(pMove[0]) = CELL_EMPTY;
+        int lCell = lowestBit(lPieces);
+        lSum += pieceSquare(at(lCell), lCell);
+    }
+    return lSum;
+}
 
-        // Promote to king if we should
-        int lDR=cellToRow(pMove[1]);
-        if ((lDR==7 && (at(pMove[1])&CELL_RED)) || (lDR==0 && (at(pMove[1])&CELL_WHITE)))
-            at(pMove[1]) |= CELL_KING;
+/**
+ * Performs a move in place, remembering what is needed to take it back
+ *
+ * \param pMove a move returned by findPossibleMoves for this state
+ * \param pUndo filled with the information unmakeMove() needs
+ */
+void GameState::makeMove(const Move &pMove, Undo &pUndo)
+{
+    uint32_t lOccupied = mRed | mWhite;
 
-        // Decrease number of moves left until draw
-        --mMovesUntilDraw;
-    }
+    pUndo.mKings = mKings;
+    pUndo.mMovesUntilDraw = mMovesUntilDraw;
+    pUndo.mHash = mHash;
+    pUndo.mPieceSquare = mPieceSquare;
+    pUndo.mLastMove = mLastMove;
 
-    // Remember last move
-    mLastMove = pMove;
+    doMove(pMove);
 
-    // Swap player
+    // Whatever was occupied before and is empty now, except the source cell, was captured
+    pUndo.mCaptured = 0;
+    if (pMove.isJump())
+        pUndo.mCaptured = lOccupied & ~(mRed | mWhite) & ~(1u << pMove[0]);
+}
+
+/**
+ * Takes back a move performed with makeMove()
+ *
+ * \param pMove the move passed to makeMove()
+ * \param pUndo the information filled by makeMove()
+ */
+void GameState::unmakeMove(const Move &pMove, const Undo &pUndo)
+{
+    // Swap player back
     mNextPlayer = mNextPlayer ^ (CELL_RED | CELL_WHITE);
 
+    if (pMove.isJump() || pMove.isNormal())
+    {
+        uint32_t lFrom = 1u << pMove[0];
+        uint32_t lTo = 1u << pMove[pMove.length()-1];
+        uint32_t &lOwn = (mRed & lTo) ? mRed : mWhite;
+        uint32_t &lOther = (mRed & lTo) ? mWhite : mRed;
+
+        // Move the piece back and put the captured pieces back on the board
+        lOwn = (lOwn & ~lTo) | lFrom;
+        lOther |= pUndo.mCaptured;
+        mKings = pUndo.mKings;
+    }
+
+    mMovesUntilDraw = pUndo.mMovesUntilDraw;
+    mHash = pUndo.mHash;
+    mPieceSquare = pUndo.mPieceSquare;
+    mLastMove = pUndo.mLastMove;
+
+    assert(mHash == computeHash());
+    assert(mPieceSquare == computePieceSquare());
 }
 
 /**
@@ -380,15 +593,8 @@ std::string GameState::toString(int pPlayer) const
 
 	bool is_winner = (isEOG() && ((pPlayer == CELL_RED && isRedWin()) || (pPlayer == CELL_WHITE && isWhiteWin())));
 	bool is_my_turn = (mNextPlayer == pPlayer);
-	int red_pieces = 0;
-	int white_pieces = 0;
-	for (int i = 0; i < cSquares; ++i)
-	{
-		if (at(i) & CELL_RED)
-			++red_pieces;
-		else if (at(i) & CELL_WHITE)
-			++white_pieces;
-	}
+	int red_pieces = countPieces(CELL_RED);
+	int white_pieces = countPieces(CELL_WHITE);
 
 	// Use a stringstream to compose the string
 	std::stringstream ss;
@@ -420,7 +626,7 @@ std::string GameState::toMessage() const
 
 	// The board goes first
     for(int i=0;i<cSquares;i++)
-		ss << MESSAGE_SYMBOLS[mCell[i]];
+		ss << MESSAGE_SYMBOLS[at(i)];
 
     // Then the information about moves
     assert(mNextPlayer == CELL_WHITE || mNextPlayer == CELL_RED);
@@ -8,10 +8,170 @@
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <type_traits>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace checkers
 {
 
+///returns the number of bits set in \p pMask
+inline int popCount(uint32_t pMask)
+{
+#ifdef _MSC_VER
+	return __popcnt(pMask);
+#else
+	return __builtin_popcount(pMask);
+#endif
+}
+
+///returns the index of the lowest bit set in \p pMask, which must not be zero
+inline int lowestBit(uint32_t pMask)
+{
+	assert(pMask != 0);
+#ifdef _MSC_VER
+	unsigned long lIndex;
+	_BitScanForward(&lIndex, pMask);
+	return lIndex;
+#else
+	return __builtin_ctz(pMask);
+#endif
+}
+
+/**
+ * The four diagonal directions, in the order in which moves are generated
+ *
+ * Red men move down the board (increasing row), white men move up.
+ */
+enum Direction
+{
+	DIR_DOWN_LEFT  = 0,	///< row+1, col-1
+	DIR_DOWN_RIGHT = 1,	///< row+1, col+1
+	DIR_UP_LEFT    = 2,	///< row-1, col-1
+	DIR_UP_RIGHT   = 3,	///< row-1, col+1
+	DIR_COUNT      = 4
+};
+
+///marks a step that would leave the board in the tables below
+const int8_t cNoCell = -1;
+
+/**
+ * Cell lookup tables, indexed by cell and Direction
+ *
+ * mNeighbor is the cell one step away and mJump the cell two steps away,
+ * where a piece lands after jumping over the neighbor. Steps that leave
+ * the board are cNoCell.
+ */
+struct CellTables
+{
+	int8_t mNeighbor[32][DIR_COUNT];
+	int8_t mJump[32][DIR_COUNT];
+};
+
+///builds the CellTables at compile time
+constexpr CellTables makeCellTables()
+{
+	CellTables lTables = {};
+	for (int lCell = 0; lCell < 32; ++lCell)
+	{
+		int lR = lCell >> 2;
+		int lC = ((lCell & 3) << 1) + ((lCell & 4) ? 0 : 1);
+		for (int lDir = 0; lDir < DIR_COUNT; ++lDir)
+		{
+			int lDR = (lDir == DIR_DOWN_LEFT || lDir == DIR_DOWN_RIGHT) ? 1 : -1;
+			int lDC = (lDir == DIR_DOWN_LEFT || lDir == DIR_UP_LEFT) ? -1 : 1;
+			for (int lSteps = 1; lSteps <= 2; ++lSteps)
+			{
+				int lToR = lR + lSteps * lDR;
+				int lToC = lC + lSteps * lDC;
+				int8_t lTo = cNoCell;
+				if (lToR >= 0 && lToR < 8 && lToC >= 0 && lToC < 8)
+					lTo = lToR * 4 + (lToC >> 1);
+				if (lSteps == 1)
+					lTables.mNeighbor[lCell][lDir] = lTo;
+				else
+					lTables.mJump[lCell][lDir] = lTo;
+			}
+		}
+	}
+	return lTables;
+}
+
+constexpr CellTables cCellTables = makeCellTables();
+
+/**
+ * Random keys for Zobrist hashing
+ *
+ * mPiece is indexed by piece kind (0 red, 1 white, 2 red king, 3 white king)
+ * and cell. mSide is added when white is to move.
+ */
+struct ZobristKeys
+{
+	uint64_t mPiece[4][32];
+	uint64_t mSide;
+};
+
+///advances the splitmix64 generator in \p pState and returns the next value
+constexpr uint64_t splitMix64(uint64_t &pState)
+{
+	uint64_t lZ = (pState += 0x9E3779B97F4A7C15ull);
+	lZ = (lZ ^ (lZ >> 30)) * 0xBF58476D1CE4E5B9ull;
+	lZ = (lZ ^ (lZ >> 27)) * 0x94D049BB133111EBull;
+	return lZ ^ (lZ >> 31);
+}
+
+///builds the ZobristKeys at compile time
+constexpr ZobristKeys makeZobristKeys()
+{
+	ZobristKeys lKeys = {};
+	uint64_t lState = 0x2380C4EC4E55ull;
+	for (int lKind = 0; lKind < 4; ++lKind)
+		for (int lCell = 0; lCell < 32; ++lCell)
+			lKeys.mPiece[lKind][lCell] = splitMix64(lState);
+	lKeys.mSide = splitMix64(lState);
+	return lKeys;
+}
+
+constexpr ZobristKeys cZobristKeys = makeZobristKeys();
+
+/**
+ * Piece-square values in hundredths of a pawn, from the point of view of red
+ *
+ * Indexed like ZobristKeys::mPiece. Men gain value as they advance and for
+ * guarding their back row, kings for staying away from the edges. White
+ * values mirror the red ones with the opposite sign.
+ */
+struct PieceSquareTable
+{
+	int8_t mValue[4][32];
+};
+
+///builds the PieceSquareTable at compile time
+constexpr PieceSquareTable makePieceSquareTable()
+{
+	PieceSquareTable lTable = {};
+	const int8_t lManRow[8] = { 6, 0, 2, 4, 6, 9, 12, 0 };
+	for (int lCell = 0; lCell < 32; ++lCell)
+	{
+		int lR = lCell >> 2;
+		int lC = ((lCell & 3) << 1) + ((lCell & 4) ? 0 : 1);
+		bool lCenter = (lR >= 2 && lR <= 5 && lC >= 2 && lC <= 5);
+		bool lEdge = (lR == 0 || lR == 7 || lC == 0 || lC == 7);
+		int8_t lMan = lManRow[lR] + ((lCenter && lR != 6) ? 3 : 0);
+		int8_t lKing = lCenter ? 6 : (lEdge ? 0 : 3);
+		// Cell 31 - i is cell i seen from the other side of the board
+		lTable.mValue[0][lCell] = lMan;
+		lTable.mValue[2][lCell] = lKing;
+		lTable.mValue[1][31 - lCell] = -lMan;
+		lTable.mValue[3][31 - lCell] = -lKing;
+	}
+	return lTable;
+}
+
+constexpr PieceSquareTable cPieceSquareTable = makePieceSquareTable();
+
 /**
  * Represents a game state with a 8x8 board
  *
@@ -48,6 +208,11 @@ namespace checkers
  * The red player starts from the top of the board (row 0,1,2)
  * The white player starts from the bottom of the board (row 5,6,7),
  * Red moves first.
+ *
+ * Internally the board is stored as three 32-bit masks (red pieces, white
+ * pieces and kings), where bit i corresponds to cell i. Moving a set of
+ * pieces one step diagonally is then a shift by 3, 4 or 5 bits, restricted
+ * to the rows and columns where that step stays inside the board.
  */
 class GameState
 {
@@ -55,6 +220,20 @@ public:
 	static const int cSquares = 32;		// 32 valid squares
 	static const int cPlayerPieces = 12;	// 12 pieces per player
 	static const int cMovesUntilDraw = 50;	///< 25 moves per player
+	static const int cMaxMoves = 128;	///< capacity of a move buffer passed to findPossibleMoves
+
+	/**
+	 * What makeMove() overwrites, so that unmakeMove() can restore it
+	 */
+	struct Undo
+	{
+		uint32_t mCaptured;		///< opponent pieces removed by the move
+		uint32_t mKings;		///< kings before the move
+		uint8_t mMovesUntilDraw;
+		uint64_t mHash;
+		int16_t mPieceSquare;
+		Move mLastMove;
+	};
 
 	/**
 	 * Initializes the board to the starting position
@@ -68,6 +247,17 @@ public:
 	 */
 	GameState(const std::string &pMessage);
 
+	/**
+	 * Constructs a board from the masks of its pieces, with no move made yet
+	 *
+	 * \param pRed the cells of the red pieces
+	 * \param pWhite the cells of the white pieces
+	 * \param pKings the cells of the kings of either color
+	 * \param pNextPlayer the player to move
+	 * \param pMovesUntilDraw the number of moves left until draw
+	 */
+	GameState(uint32_t pRed, uint32_t pWhite, uint32_t pKings, uint8_t pNextPlayer, int pMovesUntilDraw = cMovesUntilDraw);
+
 	/**
 	 * Constructs a board which is the result of applying move \p pMove to board \p pRH
 	 *
@@ -101,21 +291,50 @@ public:
 	 *
 	 *   (lBoard.At(23)&CELL_KING)
 	 */
-	uint8_t& at(int pPos)
+	uint8_t at(int pPos) const
 	{
 		assert(pPos >= 0);
 		assert(pPos < cSquares);
-		return mCell[pPos];
+		uint32_t lBit = 1u << pPos;
+		uint8_t lKing = (mKings & lBit) ? CELL_KING : CELL_EMPTY;
+		if (mRed & lBit)
+			return CELL_RED | lKing;
+		if (mWhite & lBit)
+			return CELL_WHITE | lKing;
+		return CELL_EMPTY;
 	}
 
 	/**
-	 * const version of the above function
+	 * Changes the content of a cell in the board.
+	 *
+	 * \param pPos the cell index
+	 * \param pCell the new contents, using the enumeration values in ECell
 	 */
-	const uint8_t& at(int pPos) const
+	void setAt(int pPos, uint8_t pCell)
 	{
 		assert(pPos >= 0);
 		assert(pPos < cSquares);
-		return mCell[pPos];
+		uint8_t lOld = at(pPos);
+		if (lOld != CELL_EMPTY)
+		{
+			mHash ^= pieceKey(lOld, pPos);
+			mPieceSquare -= pieceSquare(lOld, pPos);
+		}
+		if (pCell != CELL_EMPTY)
+		{
+			mHash ^= pieceKey(pCell, pPos);
+			mPieceSquare += pieceSquare(pCell, pPos);
+		}
+		uint32_t lBit = 1u << pPos;
+		mRed &= ~lBit;
+		mWhite &= ~lBit;
+		mKings &= ~lBit;
+		if (pCell & CELL_RED)
+			mRed |= lBit;
+		if (pCell & CELL_WHITE)
+			mWhite |= lBit;
+		if (pCell & CELL_KING)
+			mKings |= lBit;
 	}
 
 	/**
@@ -139,17 +358,124 @@ public:
 			return CELL_INVALID;
 		if ((pR & 1) == (pC & 1))
 			return CELL_INVALID;
-		return mCell[pR * 4 + (pC >> 1)];
+		return at(pR * 4 + (pC >> 1));
 	}
 
-private:
-	///private version of above function (allows modifying cells)
-	uint8_t &mutableAt(int pR, int pC) const
+	///returns the mask of cells occupied by red pieces
+	uint32_t getRedPieces() const
+	{
+		return mRed;
+	}
+
+	///returns the mask of cells occupied by white pieces
+	uint32_t getWhitePieces() const
 	{
-		//this is a bit ugly, but is useful for the implementation of
-		//findPossibleMoves. It won't affect in single-threaded programs
-		//and you're not allowed to use threads anyway
-		return const_cast<uint8_t&>(mCell[pR * 4 + (pC >> 1)]);
+		return mWhite;
+	}
+
+	///returns the mask of cells occupied by kings of either color
+	uint32_t getKings() const
+	{
+		return mKings;
+	}
+
+	///returns the mask of empty cells
+	uint32_t getEmpty() const
+	{
+		return ~(mRed | mWhite);
+	}
+
+	///returns the mask of cells occupied by pieces of \p pPlayer (CELL_RED or CELL_WHITE)
+	uint32_t getPieces(uint8_t pPlayer) const
+	{
+		return (pPlayer == CELL_RED) ? mRed : mWhite;
+	}
+
+	///returns the number of pieces (kings included) of \p pPlayer
+	int countPieces(uint8_t pPlayer) const
+	{
+		return popCount(getPieces(pPlayer));
+	}
+
+	///returns the number of kings of \p pPlayer
+	int countKings(uint8_t pPlayer) const
+	{
+		return popCount(getPieces(pPlayer) & mKings);
+	}
+
+	/**
+	 * Returns the number of normal moves \p pPlayer could make
+	 *
+	 * Counted with shifts of the masks, without generating the moves. Jumps
+	 * are not counted, and the moves are counted even if a jump is forced,
+	 * so this is an estimate of mobility rather than a move count.
+	 */
+	int countNormalMoves(uint8_t pPlayer) const
+	{
+		uint32_t lOwn = getPieces(pPlayer);
+		uint32_t lEmpty = getEmpty();
+		uint32_t lDown = (pPlayer == CELL_RED) ? lOwn : (lOwn & mKings);
+		uint32_t lUp = (pPlayer == CELL_WHITE) ? lOwn : (lOwn & mKings);
+		return popCount(shiftDownLeft(lDown) & lEmpty) + popCount(shiftDownRight(lDown) & lEmpty) +
+		       popCount(shiftUpLeft(lUp) & lEmpty) + popCount(shiftUpRight(lUp) & lEmpty);
+	}
+
+	static const uint32_t cEvenRows = 0x0F0F0F0F;	///< cells in rows 0, 2, 4 and 6
+	static const uint32_t cOddRows = 0xF0F0F0F0;	///< cells in rows 1, 3, 5 and 7
+	static const uint32_t cRedKingRow = 0xF0000000;	///< row 7, where red pieces are crowned
+	static const uint32_t cWhiteKingRow = 0x0000000F;	///< row 0, where white pieces are crowned
+
+	///returns \p pMask with the order of its 32 bits reversed, which maps every cell i to cell 31-i (see reversed())
+	static uint32_t reverseMask(uint32_t pMask)
+	{
+		pMask = ((pMask >> 1) & 0x55555555) | ((pMask & 0x55555555) << 1);
+		pMask = ((pMask >> 2) & 0x33333333) | ((pMask & 0x33333333) << 2);
+		pMask = ((pMask >> 4) & 0x0F0F0F0F) | ((pMask & 0x0F0F0F0F) << 4);
+		pMask = ((pMask >> 8) & 0x00FF00FF) | ((pMask & 0x00FF00FF) << 8);
+		return (pMask >> 16) | (pMask << 16);
+	}
+
+	///moves every cell in \p pMask one step to (row+1, col-1), dropping those that leave the board
+	static uint32_t shiftDownLeft(uint32_t pMask)
+	{
+		return ((pMask & cEvenRows) << 4) | ((pMask & 0xE0E0E0E0) << 3);
+	}
+
+	///moves every cell in \p pMask one step to (row+1, col+1), dropping those that leave the board
+	static uint32_t shiftDownRight(uint32_t pMask)
+	{
+		return ((pMask & 0x07070707) << 5) | ((pMask & cOddRows) << 4);
+	}
+
+	///moves every cell in \p pMask one step to (row-1, col-1), dropping those that leave the board
+	static uint32_t shiftUpLeft(uint32_t pMask)
+	{
+		return ((pMask & cEvenRows) >> 4) | ((pMask & 0xE0E0E0E0) >> 5);
+	}
+
+	///moves every cell in \p pMask one step to (row-1, col+1), dropping those that leave the board
+	static uint32_t shiftUpRight(uint32_t pMask)
+	{
+		return ((pMask & 0x07070707) >> 3) | ((pMask & cOddRows) >> 4);
+	}
+
+	///returns the cell one step from \p pCell in direction \p pDir, or cNoCell
+	static int neighbor(int pCell, int pDir)
+	{
+		return cCellTables.mNeighbor[pCell][pDir];
+	}
+
+	///returns the cell where a piece on \p pCell lands when jumping in direction \p pDir, or cNoCell
+	static int jumpLanding(int pCell, int pDir)
+	{
+		return cCellTables.mJump[pCell][pDir];
+	}
+
+	///returns the first and one past the last Direction a piece of \p pPlayer can move in
+	static void moveDirections(uint8_t pPlayer, bool pKing, int &pFirst, int &pEnd)
+	{
+		pFirst = (pKing || pPlayer == CELL_RED) ? DIR_DOWN_LEFT : DIR_UP_LEFT;
+		pEnd = (pKing || pPlayer == CELL_WHITE) ? DIR_COUNT : DIR_UP_LEFT;
 	}
 
 public:
@@ -183,30 +509,34 @@ public:
 
 private:
 	/**
-	 * Tries to make a jump from a certain position of the board
+	 * Finds all the jump sequences starting from a certain position of the board
+	 *
+	 * Multiple jumps are followed with a small stack of local frames, in
+	 * the same depth-first order a recursive search would use. Captured
+	 * pieces and vacated cells are tracked in masks in those frames, so
+	 * the board itself is never written and several threads can generate
+	 * moves from the same state at once.
 	 *
-	 * \param pMoves a vector where the valid moves will be inserted
-	 * \param pOther the \ref ECell code corresponding to the player who is not making the move
-	 * \param pR the row of the cell we are moving from
-	 * \param pC the col
+	 * \param pMoves a buffer where the valid moves will be inserted
+	 * \param pNumMoves the number of moves in \p pMoves, updated on return
+	 * \param pCell the cell of the piece making the jumps
 	 * \param pKing true if the moving piece is a king
-	 * \param pBuffer a buffer where the list of jump positions is
-	 * inserted (for multiple jumps)
-	 * \param pDepth the number of multiple jumps before this attempt
+	 * \return true if at least one jump was found
 	 */
-	bool tryJump(std::vector<Move> &pMoves, int pR, int pC, bool pKing,
-			uint8_t *pBuffer, int pDepth = 0) const;
+	bool tryJump(Move *pMoves, int &pNumMoves, int pCell, bool pKing) const;
 
 	/**
 	 * Tries to make a move from a certain position
 	 *
-	 * \param pMoves vector where the valid moves will be inserted
+	 * \param pMoves buffer where the valid moves will be inserted
+	 * \param pNumMoves the number of moves in \p pMoves, updated on return
 	 * \param pCell the cell where the move is tried from
-	 * \param pOther the \ref ECell code corresponding to the player
-	 * who is not making the move
 	 * \param pKing true if the piece is a king
 	 */
-	void tryMove(std::vector<Move> &pMoves, int pCell, bool pKing) const;
+	void tryMove(Move *pMoves, int &pNumMoves, int pCell, bool pKing) const;
+
+	///returns the mask of pieces of the player to move which can capture something
+	uint32_t findJumpers() const;
 
 public:
 	/**
@@ -218,6 +548,54 @@ public:
 	 */
 	void findPossibleMoves(std::vector<GameState> &pMoves) const;
 
+	/**
+	 * Writes all valid moves for the player to move into \p pMoves
+	 *
+	 * Unlike the version above, no GameState is built for the moves. Pass
+	 * each of them to makeMove() to visit the resulting state. As in the
+	 * version above, the list consists of a single MOVE_DRAW or loss
+	 * (MOVE_RW/MOVE_WW) move when the game ends on this turn, and is empty
+	 * if the game is already over.
+	 *
+	 * The state is only read, so this can be called from several threads.
+	 *
+	 * \param pMoves a buffer with room for at least cMaxMoves moves
+	 * \return the number of moves written
+	 */
+	int findPossibleMoves(Move *pMoves) const;
+
+	///returns true if the player to move can capture, in which case only jumps are valid
+	bool hasCaptures() const
+	{
+		return findJumpers() != 0;
+	}
+
+	/**
+	 * Writes all the jump sequences of the player to move into \p pMoves
+	 *
+	 * \param pMoves a buffer with room for at least cMaxMoves moves
+	 * \return the number of moves written
+	 */
+	int findCaptures(Move *pMoves) const;
+
+	/**
+	 * Writes all the normal (non-jump) moves of the player to move into \p pMoves
+	 *
+	 * These are only valid if hasCaptures() is false.
+	 *
+	 * \param pMoves a buffer with room for at least cMaxMoves moves
+	 * \return the number of moves written
+	 */
+	int findQuietMoves(Move *pMoves) const;
+
+	/**
+	 * Returns true if \p pMove is one of the jumps or normal moves findPossibleMoves would return
+	 *
+	 * Useful to check moves remembered from other positions (hash moves,
+	 * killer moves) before playing them.
+	 */
+	bool isLegal(const Move &pMove) const;
+
 	/**
 	 * Transforms the board by performing a move
 	 *
@@ -227,6 +605,24 @@ public:
 	 */
 	void doMove(const Move &pMove);
 
+	/**
+	 * Performs a move in place, remembering what is needed to take it back
+	 *
+	 * \param pMove a move returned by findPossibleMoves for this state
+	 * \param pUndo filled with the information unmakeMove() needs
+	 */
+	void makeMove(const Move &pMove, Undo &pUndo);
+
+	/**
+	 * Takes back a move performed with makeMove()
+	 *
+	 * Moves must be taken back in the reverse order they were made.
+	 *
+	 * \param pMove the move passed to makeMove()
+	 * \param pUndo the information filled by makeMove()
+	 */
+	void unmakeMove(const Move &pMove, const Undo &pUndo);
+
 	/**
 	 * Convert the board to a human readable string ready to be printed to std::cerr
 	 *
@@ -259,6 +655,49 @@ public:
 		return mMovesUntilDraw;
 	}
 
+	/**
+	 * Returns the Zobrist key of the position
+	 *
+	 * It covers the pieces, the kings and the player to move, but not the
+	 * number of moves until draw. It is kept up to date by doMove, so
+	 * reading it costs nothing.
+	 */
+	uint64_t getHash() const
+	{
+		return mHash;
+	}
+
+	///computes the Zobrist key of the position from scratch
+	uint64_t computeHash() const;
+
+	///returns the Zobrist key of a piece \p pCell (an ECell code) on cell \p pPos
+	static uint64_t pieceKey(uint8_t pCell, int pPos)
+	{
+		int lKind = ((pCell & CELL_WHITE) ? 1 : 0) + ((pCell & CELL_KING) ? 2 : 0);
+		return cZobristKeys.mPiece[lKind][pPos];
+	}
+
+	/**
+	 * Returns the sum of the piece-square values of all pieces on the board
+	 *
+	 * In hundredths of a pawn, positive when red stands better (see
+	 * PieceSquareTable). Kept up to date by doMove like the hash.
+	 */
+	int getPieceSquare() const
+	{
+		return mPieceSquare;
+	}
+
+	///computes the sum of the piece-square values from scratch
+	int computePieceSquare() const;
+
+	///returns the piece-square value of a piece \p pCell (an ECell code) on cell \p pPos
+	static int pieceSquare(uint8_t pCell, int pPos)
+	{
+		int lKind = ((pCell & CELL_WHITE) ? 1 : 0) + ((pCell & CELL_KING) ? 2 : 0);
+		return cPieceSquareTable.mValue[lKind][pPos];
+	}
+
 	/// returns true if the movement marks beginning of game
 	bool isBOG() const
 	{
@@ -286,12 +725,18 @@ public:
 	}
 
 private:
-	uint8_t mCell[cSquares];
+	uint32_t mRed;		///< cells occupied by red pieces
+	uint32_t mWhite;	///< cells occupied by white pieces
+	uint32_t mKings;	///< cells occupied by kings of either color
 	uint8_t mMovesUntilDraw;
 	uint8_t mNextPlayer;
+	uint64_t mHash;		///< Zobrist key, see getHash()
+	int16_t mPieceSquare;	///< see getPieceSquare()
 	Move mLastMove;
 };
 
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState must be copyable without allocating");
+
 /*namespace checkers*/}
 
 #endif
@@ -10,6 +10,18 @@ int main(int argc, char **argv)
     bool init = false;
     bool verbose = false;
     bool fast = false;
+    bool ponder = false;
+    int hash_megabytes = checkers::TranspositionTable::cDefaultMegabytes;
+    double stop_margin = -1.0;
+    int reductions = -1;
+    int futility = -1;
+    int probcut = -1;
+    int batch = -1;
+    int eval_cache = -1;
+    int threads = 1;
+    int split_points = -1;
+    std::string database_directory;
+    int solver = -1;
     for (int i = 1; i < argc; ++i)
     {
         std::string param(argv[i]);
@@ -19,6 +31,30 @@ int main(int argc, char **argv)
             verbose = true;
         else if (param == "fast" || param == "f")
             fast = true;
+        else if (param == "ponder" || param == "p")
+            ponder = true;
+        else if (param == "--hash" && i + 1 < argc)
+            hash_megabytes = atoi(argv[++i]);
+        else if (param == "--margin" && i + 1 < argc)
+            stop_margin = atof(argv[++i]);
+        else if (param == "--lmr" && i + 1 < argc)
+            reductions = atoi(argv[++i]);
+        else if (param == "--futility" && i + 1 < argc)
+            futility = atoi(argv[++i]);
+        else if (param == "--probcut" && i + 1 < argc)
+            probcut = atoi(argv[++i]);
+        else if (param == "--batch" && i + 1 < argc)
+            batch = atoi(argv[++i]);
+        else if (param == "--evalcache" && i + 1 < argc)
+            eval_cache = atoi(argv[++i]);
+        else if (param == "--threads" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (param == "--ybwc" && i + 1 < argc)
+            split_points = atoi(argv[++i]);
+        else if (param == "--egdb" && i + 1 < argc)
+            database_directory = argv[++i];
+        else if (param == "--solver" && i + 1 < argc)
+            solver = atoi(argv[++i]);
         else
         {
             std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
@@ -35,6 +71,31 @@ int main(int argc, char **argv)
     }
 
     checkers::Player player;
+    if (hash_megabytes != (int)checkers::TranspositionTable::cDefaultMegabytes)
+        player.transpositionTable.resize(hash_megabytes);
+    if (stop_margin >= 0.0)
+        player.stopMargin = stop_margin;
+    if (reductions >= 0)
+        player.useReductions = reductions;
+    if (futility >= 0)
+        player.useFutility = futility;
+    if (probcut >= 0)
+        player.useProbCut = probcut;
+    if (batch >= 0)
+        player.useBatchEval = batch;
+    if (eval_cache >= 0)
+        player.useEvalCache = eval_cache;
+    if (split_points >= 0)
+    {
+        player.useSplitPoints = split_points > 0;
+        player.reproducibleSplits = split_points == 2;
+    }
+    if (solver >= 0)
+        player.useSolver = solver;
+    if (threads > 1)
+        player.setThreads(threads);
+    if (!database_directory.empty() && !player.endgameDatabase.open(database_directory))
+        std::cerr << "No endgame database found in '" << database_directory << "'" << std::endl;
 
     std::string input_message;
     while (std::getline(std::cin, input_message))
@@ -68,6 +129,9 @@ int main(int argc, char **argv)
         // Deadline is one second from when we receive the message
         checkers::Deadline deadline = checkers::Deadline::now() + (fast ? 0.1 : 1.0);
 
+        // What was searched while the opponent thought is in the transposition table
+        player.stopPondering();
+
         // Figure out the next move
         checkers::GameState output_state = player.play(input_state, deadline);
 
@@ -78,6 +142,22 @@ int main(int argc, char **argv)
         // Print the output state
         if (verbose)
         {
+            std::cerr << "Searched to depth " << player.completedDepth << " (" << player.nodes << " nodes, score "
+                      << player.score << ")" << std::endl;
+            if (player.cutoffs)
+                std::cerr << "First move cut-offs: " << 100.0 * player.firstMoveCutoffs / player.cutoffs << "% of "
+                          << player.cutoffs << std::endl;
+            if (player.tableProbes)
+                std::cerr << "Transposition table hit rate: " << 100.0 * player.tableHits / player.tableProbes << "% of "
+                          << player.tableProbes << " probes" << std::endl;
+            if (player.solverNodes)
+                std::cerr << "Solver: " << (player.solved > 0 ? "proven win" : player.solved < 0 ? "proven loss" : "no proof")
+                          << " (" << player.solverNodes << " positions)" << std::endl;
+            if (player.endgameDatabase.getMaxPieces())
+                std::cerr << "Endgame database hits: " << player.databaseHits << std::endl;
+            if (player.evalCacheProbes)
+                std::cerr << "Evaluation cache hit rate: " << 100.0 * player.evalCacheHits / player.evalCacheProbes << "% of "
+                          << player.evalCacheProbes << " probes" << std::endl;
             std::cerr << output_state.toMessage() << std::endl;
             std::cerr << output_state.toString(input_state.getNextPlayer())    << std::endl;
         }
@@ -90,6 +170,10 @@ int main(int argc, char **argv)
         // Quit if this is end of game
 		if (output_state.getMove().isEOG())
 			break;
+
+        // Keep searching while the opponent thinks
+        if (ponder)
+            player.startPondering(output_state);
             
     }
 }
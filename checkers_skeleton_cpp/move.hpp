@@ -3,10 +3,11 @@
 
 #include "constants.hpp"
 #include <stdint.h>
-#include <vector>
+#include <cstring>
 #include <string>
 #include <sstream>
 #include <cassert>
+#include <type_traits>
 
 namespace checkers {
 
@@ -19,10 +20,16 @@ namespace checkers {
  * The functions IsNormal(), IsJump() and IsEOG(), might be useful.
  *
  * You can probably ignore the rest of the interface.
+ *
+ * The squares are stored inline, so moves (and the GameStates that embed
+ * them) can be copied without any heap allocation.
  */
 class Move
 {
 public:
+    ///maximum number of squares in a move (a jump chain visits at most 9)
+    static const int cMaxLength = 12;
+
     enum MoveType
     {
         MOVE_JUMP=1,   ///< a single jump (numbers above that will represent multiple jumps)
@@ -40,6 +47,7 @@ public:
     ///\param pType should be one of MOVE_BOG, MOVE_RW, MOVE_WW or MOVE_DRAW
     explicit Move(MoveType pType=MOVE_BOG)
         :   mType(pType)
+        ,   mLength(0)
     {
     }
 
@@ -49,8 +57,8 @@ public:
     ///\param p2 the destination square
     Move(uint8_t p1,uint8_t p2)
         :	mType(MOVE_NORMAL)
+        ,   mLength(2)
     {
-    	mData.resize(2);
     	mData[0] = p1;
     	mData[1] = p2;
     }
@@ -61,8 +69,10 @@ public:
     ///\param pLen the number of squares in pData
     Move(uint8_t *pData,std::size_t pLen)
         :	mType(pLen-1)
-        ,   mData(pData, pData + pLen)
+        ,   mLength(pLen)
     {
+        assert(pLen <= (std::size_t)cMaxLength);
+        memcpy(mData, pData, pLen);
     }
     
     ///reconstructs the move from a string
@@ -70,6 +80,7 @@ public:
     ///\param pString a string, which should have been previously generated
     ///by ToString(), or obtained from the server
     Move(const std::string &pString)
+        :   mLength(0)
     {
         std::istringstream lStream(pString);
         
@@ -82,13 +93,14 @@ public:
         else if(mType>0)
             lLen = mType+1;
             
-        if (lLen>12 || mType<MOVE_NULL)
+        if (lLen>cMaxLength || mType<MOVE_NULL)
         {
             mType=MOVE_NULL;
             return;
         }
             
-        mData.resize(lLen);
+        mLength=lLen;
+        memset(mData, 0, lLen);
             
         for (int i=0; i<lLen; ++i)
         {
@@ -116,7 +128,7 @@ public:
     	else if (isWhiteWin())
     		result.mType = MOVE_RW;
 
-    	for (unsigned i=0; i < mData.size(); ++i)
+    	for (unsigned i=0; i < mLength; ++i)
 			result.mData[i] = 33 - mData[i];
 
     	return result;
@@ -143,16 +155,16 @@ public:
     int getType() const { return mType; }
     
     ///returns (for normal moves and jumps) the number of squares
-    std::size_t length() const { return mData.size(); }
+    std::size_t length() const { return mLength; }
     ///returns the pNth square in the sequence
-    uint8_t operator[](int pN) const { return mData[pN]; }
+    uint8_t operator[](int pN) const { assert(pN < mLength); return mData[pN]; }
 
     ///converts the move to a string so that it can be sent to the other player
     std::string toMessage() const
     {
         std::ostringstream lStream;
         lStream << mType;
-        for(unsigned i=0;i<mData.size();++i)
+        for(unsigned i=0;i<mLength;++i)
         {
             lStream << cDelimiter << (int)mData[i];
         }
@@ -176,11 +188,11 @@ public:
 
         std::ostringstream lStream;
     	char delimiter = isNormal() ? '-' : 'x';
-    	assert(mData.size() > 0);
+    	assert(mLength > 0);
 
     	// Concatenate all the cell numbers
 		lStream << (int)mData[0];
-        for(unsigned i=1; i<mData.size(); ++i)
+        for(unsigned i=1; i<mLength; ++i)
             lStream << delimiter << (int)mData[i];
 
         return lStream.str();
@@ -190,19 +202,22 @@ public:
     bool operator==(const Move &pRH) const
     {
         if (mType != pRH.mType) return false;
-        if (mData.size() != pRH.mData.size()) return false;
+        if (mLength != pRH.mLength) return false;
         
-        for (unsigned i=0; i<mData.size(); ++i)
+        for (unsigned i=0; i<mLength; ++i)
             if (mData[i] != pRH.mData[i]) return false;
         return true;
     }
     
 private:
     int mType;
-    std::vector<uint8_t> mData;
+    uint8_t mLength;
+    uint8_t mData[cMaxLength];
     static const char cDelimiter = '_';
 };
 
+static_assert(std::is_trivially_copyable<Move>::value, "Move must be copyable without allocating");
+
 /*namespace checkers*/ }
 
 #endif
@@ -0,0 +1,165 @@
+#include "movepicker.hpp"
+#include <algorithm>
+
+namespace checkers
+{
+
+MovePicker::MovePicker(const GameState &pState, Move *pBuffer, const Move &pHashMove,
+                       const Move *pKillers, int pNumKillers, const History *pHistory)
+    :   mState(pState)
+    ,   mMoves(pBuffer)
+    ,   mNumMoves(0)
+    ,   mCurrent(0)
+    ,   mStage(STAGE_HASH)
+    ,   mNumPicked(0)
+    ,   mHasCaptures(false)
+    ,   mHashMove(pHashMove)
+    ,   mNumKillers(0)
+    ,   mHistory(pHistory)
+{
+    if (pState.isEOG())
+    {
+        mStage = STAGE_DONE;
+        return;
+    }
+    // Only a draw can be claimed once the move counter runs out
+    if (pState.getMovesUntilDraw() <= 0)
+    {
+        mStage = STAGE_END_OF_GAME;
+        return;
+    }
+
+    mHasCaptures = pState.hasCaptures();
+
+    // Killers are normal moves, which are not allowed when a jump is possible
+    if (!mHasCaptures)
+    {
+        for (int i = 0; i < pNumKillers && mNumKillers < cMaxKillers; ++i)
+        {
+            if (pKillers[i].isNormal())
+            {
+                mKillers[mNumKillers] = pKillers[i];
+                mKillerPicked[mNumKillers] = false;
+                ++mNumKillers;
+            }
+        }
+    }
+}
+
+bool MovePicker::alreadyPicked(const Move &pMove) const
+{
+    if (!mHashMove.isNull() && pMove == mHashMove)
+        return true;
+    for (int i = 0; i < mNumKillers; ++i)
+        if (mKillerPicked[i] && pMove == mKillers[i])
+            return true;
+    return false;
+}
+
+bool MovePicker::next(Move &pMove)
+{
+    switch (mStage)
+    {
+    case STAGE_HASH:
+        mStage = STAGE_CAPTURES_INIT;
+        if (!mHashMove.isNull() && mState.isLegal(mHashMove))
+        {
+            pMove = mHashMove;
+            ++mNumPicked;
+            return true;
+        }
+        mHashMove = Move(Move::MOVE_NULL);
+        // fall through
+    case STAGE_CAPTURES_INIT:
+        if (!mHasCaptures)
+        {
+            mStage = STAGE_KILLERS;
+            mCurrent = 0;
+            return next(pMove);
+        }
+        mNumMoves = mState.findCaptures(mMoves);
+        mCurrent = 0;
+        mStage = STAGE_CAPTURES;
+        // fall through
+    case STAGE_CAPTURES:
+        while (mCurrent < mNumMoves)
+        {
+            const Move &lMove = mMoves[mCurrent++];
+            if (!alreadyPicked(lMove))
+            {
+                pMove = lMove;
+                ++mNumPicked;
+                return true;
+            }
+        }
+        // Captures are forced, so no other stage applies
+        mStage = STAGE_END_OF_GAME;
+        return next(pMove);
+    case STAGE_KILLERS:
+        while (mCurrent < mNumKillers)
+        {
+            int lKiller = mCurrent++;
+            const Move &lMove = mKillers[lKiller];
+            if (!alreadyPicked(lMove) && mState.isLegal(lMove))
+            {
+                mKillerPicked[lKiller] = true;
+                pMove = lMove;
+                ++mNumPicked;
+                return true;
+            }
+        }
+        mStage = STAGE_QUIETS_INIT;
+        // fall through
+    case STAGE_QUIETS_INIT:
+        mNumMoves = mState.findQuietMoves(mMoves);
+        mCurrent = 0;
+        mStage = STAGE_QUIETS;
+        if (mHistory)
+        {
+            for (int i = 0; i < mNumMoves; ++i)
+                mScores[i] = (*mHistory)[mMoves[i][0]][mMoves[i][1]];
+        }
+        // fall through
+    case STAGE_QUIETS:
+        while (mCurrent < mNumMoves)
+        {
+            // Bring the best scored move forward; a cutoff usually comes before the list is sorted
+            if (mHistory)
+            {
+                int lBest = mCurrent;
+                for (int i = mCurrent + 1; i < mNumMoves; ++i)
+                    if (mScores[i] > mScores[lBest])
+                        lBest = i;
+                std::swap(mMoves[mCurrent], mMoves[lBest]);
+                std::swap(mScores[mCurrent], mScores[lBest]);
+            }
+            const Move &lMove = mMoves[mCurrent++];
+            if (!alreadyPicked(lMove))
+            {
+                pMove = lMove;
+                ++mNumPicked;
+                return true;
+            }
+        }
+        mStage = STAGE_END_OF_GAME;
+        // fall through
+    case STAGE_END_OF_GAME:
+        mStage = STAGE_DONE;
+        // Claim a draw if the move counter ran out, admit loss if no moves were found
+        if (mState.getMovesUntilDraw() <= 0)
+        {
+            pMove = Move(Move::MOVE_DRAW);
+            return true;
+        }
+        if (mNumPicked == 0)
+        {
+            pMove = Move(mState.getNextPlayer() == CELL_WHITE ? Move::MOVE_RW : Move::MOVE_WW);
+            return true;
+        }
+        // fall through
+    default:
+        return false;
+    }
+}
+
+/*namespace checkers*/ }
@@ -0,0 +1,93 @@
+#ifndef _CHECKERS_MOVEPICKER_HPP_
+#define _CHECKERS_MOVEPICKER_HPP_
+
+#include "gamestate.hpp"
+#include "move.hpp"
+
+namespace checkers
+{
+
+/**
+ * Hands out the moves of a position one at a time, generating them in stages
+ *
+ * The stages are, in order:
+ *  - the hash move (usually the best move found by an earlier search), if given and legal
+ *  - all the jumps; since captures are forced, nothing else is tried if there are any
+ *  - the killer moves, if given and legal
+ *  - the remaining normal moves, highest history score first if a history table is given
+ *
+ * A stage is only generated once the previous one is used up, so a search
+ * that cuts off after the first move doesn't pay for generating the rest.
+ *
+ * As with findPossibleMoves, a position where the game ends on this turn
+ * yields a single MOVE_DRAW or loss move, and a finished game yields nothing.
+ */
+class MovePicker
+{
+public:
+    static const int cMaxKillers = 2;
+
+    ///scores of normal moves by source and destination cell, higher is tried earlier
+    typedef uint32_t History[GameState::cSquares][GameState::cSquares];
+
+    /**
+     * Prepares to pick the moves of \p pState
+     *
+     * \param pState the position; it must not change while moves are picked
+     * \param pBuffer room for at least GameState::cMaxMoves moves, used for the generated stages
+     * \param pHashMove the move to try first, or a null move
+     * \param pKillers moves to try right after the jumps (at most cMaxKillers), or NULL
+     * \param pNumKillers the number of moves in \p pKillers
+     * \param pHistory scores used to order the remaining normal moves, or NULL to keep the generated order
+     */
+    MovePicker(const GameState &pState, Move *pBuffer, const Move &pHashMove = Move(Move::MOVE_NULL),
+               const Move *pKillers = NULL, int pNumKillers = 0, const History *pHistory = NULL);
+
+    /**
+     * Gets the next move
+     *
+     * \param pMove receives the move
+     * \return false when there are no more moves
+     */
+    bool next(Move &pMove);
+
+    ///changes the history used to order the normal moves, if they haven't been generated yet
+    void setHistory(const History *pHistory)    {    mHistory = pHistory;    }
+
+    ///returns true if the position has jumps (so every move picked is a jump)
+    bool hasCaptures() const    {    return mHasCaptures;    }
+
+private:
+    enum Stage
+    {
+        STAGE_HASH,
+        STAGE_CAPTURES_INIT,
+        STAGE_CAPTURES,
+        STAGE_KILLERS,
+        STAGE_QUIETS_INIT,
+        STAGE_QUIETS,
+        STAGE_END_OF_GAME,
+        STAGE_DONE
+    };
+
+    ///returns true if \p pMove was already handed out by the hash or killer stages
+    bool alreadyPicked(const Move &pMove) const;
+
+    const GameState &mState;
+    Move *mMoves;
+    int mNumMoves;
+    int mCurrent;
+    int mStage;
+    int mNumPicked;
+    bool mHasCaptures;
+    Move mHashMove;
+    Move mKillers[cMaxKillers];
+    int mNumKillers;
+    bool mKillerPicked[cMaxKillers];
+    const History *mHistory;
+    uint32_t mScores[GameState::cMaxMoves];
+};
+
+/*namespace checkers*/ }
+
+#endif
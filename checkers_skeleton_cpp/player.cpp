@@ -1,155 +1,988 @@
 #include "player.hpp"
 #include <cstdlib>
 #include <math.h>
+#include <algorithm>
 #include <limits>
 
 
 namespace checkers
 {
 
+Player::Player()
+{
+	Player::setThreads(1);
+}
+
+Player::~Player()
+{
+	Player::stopPondering();
+	Player::setThreads(0);
+}
+
+void Player::setThreads(int count)
+{
+	//End the helpers, then start the new number of them.
+	{
+		std::lock_guard<std::mutex> lock(helperMutex);
+		helpersQuit = true;
+	}
+	helperWakeUp.notify_all();
+	for (size_t t = 1; t < threads.size(); t++) threads[t]->thread.join();
+	helpersQuit = false;
+
+	threads.resize(std::max(count, 0));
+	for (int t = 0; t < count; t++)
+	{
+		if (!threads[t]) threads[t].reset(new SearchThread());
+		threads[t]->id = t;
+		for (int i = 0; i < killerPlies; i++)
+			for (int k = 0; k < MovePicker::cMaxKillers; k++) threads[t]->killers[i][k] = Move(Move::MOVE_NULL);
+		if (t > 0) threads[t]->thread = std::thread(&Player::HelperLoop, this, std::ref(*threads[t]));
+	}
+}
+
 GameState Player::play(const GameState &pState,const Deadline &pDue)
+{
+	//Keep a safety margin of the time we were given.
+	Deadline start = Deadline::now();
+	stopTime = pDue - std::max(stopMargin, (pDue - start) * timeMargin);
+	stopTimer.start(stopTime);
+	return Player::Think(pState);
+}
+
+void Player::startPondering(const GameState &pState)
+{
+	//The timer is armed here rather than on the new thread, so that stopPondering can't be overtaken.
+	Player::stopPondering();
+	stopTime = Deadline::now() + ponderLimit;
+	stopTimer.start(stopTime);
+	ponderThread = std::thread([this, pState] { Player::Think(pState); });
+}
+
+void Player::stopPondering()
+{
+	if (!ponderThread.joinable()) return;
+	stopTimer.stop();
+	ponderThread.join();
+}
+
+GameState Player::Think(const GameState &pState)
 {
     //std::cerr << "Processing " << pState.toMessage() << std::endl;
 
-    std::vector<GameState> lNextStates;
-    pState.findPossibleMoves(lNextStates);
+    Deadline think_start = Deadline::now();
+    Move lMoves[GameState::cMaxMoves];
+    int lNumMoves = pState.findPossibleMoves(lMoves);
+
+    if (lNumMoves == 0)
+    {
+        stopTimer.cancel();
+        return GameState(pState, Move());
+    }
 
-    if (lNextStates.size() == 0) return GameState(pState, Move());
+    //Searched in place with makeMove/unmakeMove.
+    GameState lState = pState;
 
     /*
      * Here you should write your clever algorithms to get the best next move, ie the best
      * next state. This skeleton returns a random move instead.
      */
 
-	//Determine player's color.
-	uint8_t nextPlayer = pState.getNextPlayer();
-	if (nextPlayer&CELL_RED) color = 1;
-	else if (nextPlayer&CELL_WHITE) color = -1;
+	//Scores are from the point of view of the side to move, so stored results stay valid for both colors.
+	transpositionTable.newSearch();
+
+	//Killers are only good for nearby positions, older history counts less.
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		SearchThread &thread = *threads[t];
+		for (int i = 0; i < killerPlies; i++)
+			for (int k = 0; k < MovePicker::cMaxKillers; k++) thread.killers[i][k] = Move(Move::MOVE_NULL);
+		for (int from = 0; from < GameState::cSquares; from++)
+			for (int to = 0; to < GameState::cSquares; to++) thread.history[from][to] /= 2;
+		thread.nodes = 0;
+		thread.cutoffs = 0;
+		thread.firstMoveCutoffs = 0;
+		thread.tableProbes = 0;
+		thread.tableHits = 0;
+		thread.evalCacheProbes = 0;
+		thread.evalCacheHits = 0;
+		thread.databaseHits = 0;
+	}
+
+	//Nothing to think about with a single choice (this includes claiming a draw or admitting loss).
+	nodes = 0;
+	cutoffs = 0;
+	firstMoveCutoffs = 0;
+	tableProbes = 0;
+	tableHits = 0;
+	evalCacheProbes = 0;
+	evalCacheHits = 0;
+	databaseHits = 0;
+	completedDepth = 0;
+	solved = 0;
+	solverNodes = 0;
+	score = 0.0;
+	if (lNumMoves == 1)
+	{
+		stopTimer.cancel();
+		return GameState(pState, lMoves[0]);
+	}
+
+	//Try to solve forced positions outright with part of the time: a proven win needs no search. If the position
+	//is not won, it may be lost, and then the search only has to find the longest resistance.
+	if (useSolver && Player::IsForced(pState, lNumMoves))
+	{
+		Deadline solver_due = Deadline::now() + std::min(solverMaxTime, (stopTime - Deadline::now()) * solverShare);
+		uint8_t opponent = (pState.getNextPlayer() == CELL_RED) ? CELL_WHITE : CELL_RED;
+		Move solution(Move::MOVE_NULL);
+		ProofNumberSolver::Result result = solver.solve(pState, pState.getNextPlayer(), solver_due, stopTimer, endgameDatabase, solution);
+		solverNodes = solver.getNodes();
+		if (result == ProofNumberSolver::RESULT_PROVEN && !solution.isNull())
+		{
+			solved = 1;
+			score = winScore - maxPly; //Won, in an unknown number of plies
+			stopTimer.cancel();
+			return GameState(pState, solution);
+		}
+		if (result == ProofNumberSolver::RESULT_DISPROVEN &&
+		    solver.solve(pState, opponent, solver_due, stopTimer, endgameDatabase, solution) == ProofNumberSolver::RESULT_PROVEN)
+			solved = -1;
+		solverNodes += solver.getNodes();
+	}
+
+	//Start the helpers on the same root.
+	SearchThread &main_thread = *threads[0];
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		SearchThread &thread = *threads[t];
+		thread.timeCheck = DeadlineCheck(stopTime, nodesPerTimeCheck);
+		if (useSplitPoints && reproducibleSplits)
+			while (thread.taskTables.size() < (size_t)maxSplitPoints) thread.taskTables.emplace_back(taskTableMegabytes);
+		if (t == 0) continue;
+		thread.rootState = pState;
+		std::copy(lMoves, lMoves + lNumMoves, thread.rootMoves);
+		thread.numRootMoves = lNumMoves;
+	}
+	if (threads.size() > 1)
+	{
+		{
+			std::lock_guard<std::mutex> lock(helperMutex);
+			helperSearchId++;
+			helpersSearching = threads.size() - 1;
+		}
+		helperWakeUp.notify_all();
+	}
 
-	//Initialize move choice and move value.
-	unsigned int move;
+	//Best move of the last completed iteration (kept at the front of lMoves).
+	int move = 0;
+	const double infinity = std::numeric_limits<double>::infinity();
 
 	//Iterative deepening
-	for (int d = 7; d < 15; d++)
+	for (int d = 1; d <= maxDepth; d++)
 	{
-		//Initialize value and move.
-		double value = -1 * std::numeric_limits<double>::infinity();
+		//Aspiration window: expect the score of the last iteration, and widen the side
+		//that failed until the score falls inside (the first iteration uses a full window).
+		double window = aspirationWindow;
+		double alpha = -infinity, beta = infinity;
+		if (d > 1)
+		{
+			alpha = score - window;
+			beta = score + window;
+		}
+
+		double value;
+		int iteration_move;
+		while (true)
+		{
+			value = Player::SearchRoot(main_thread, lState, lMoves, lNumMoves, d, alpha, beta, iteration_move);
+			if (stopTimer.stopped()) break;
+
+			window *= 2;
+			if (value <= alpha) alpha = (window > winScore) ? -infinity : value - window;
+			else if (value >= beta) beta = (window > winScore) ? infinity : value + window;
+			else break;
+		}
+		//When stopped, a move that beat the previous best (searched first) is still the best found so far.
+		if (stopTimer.stopped())
+		{
+			if (iteration_move > 0) move = iteration_move;
+			break;
+		}
+
+		//Search the best move first in the next iteration.
+		std::swap(lMoves[0], lMoves[iteration_move]);
 		move = 0;
+		completedDepth = d;
+		score = value;
+
+		//Start the next iteration while a good share of the time is left, and let stopTimer cut it off if it takes too
+		//long: its best move so far is kept then. Past that share, it would most likely not get through its first move.
+		if (Deadline::now() - think_start > (stopTime - think_start) * iterationShare) break;
+	}
 
-		//Initialize alpha and beta values to minus and plus infinity respectively.
-		double alpha = -1 * std::numeric_limits<double>::infinity();
-		double beta = std::numeric_limits<double>::infinity();
+	//Stop the helpers, their results are in the transposition table already.
+	if (threads.size() > 1)
+	{
+		stopTimer.stop();
+		std::unique_lock<std::mutex> lock(helperMutex);
+		helperDone.wait(lock, [this] { return helpersSearching == 0; });
+	}
+	stopTimer.cancel();
 
-		//Time left
-		double time_left_before = 1.0;
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		nodes += threads[t]->nodes;
+		cutoffs += threads[t]->cutoffs;
+		firstMoveCutoffs += threads[t]->firstMoveCutoffs;
+		tableProbes += threads[t]->tableProbes;
+		tableHits += threads[t]->tableHits;
+		evalCacheProbes += threads[t]->evalCacheProbes;
+		evalCacheHits += threads[t]->evalCacheHits;
+		databaseHits += threads[t]->databaseHits;
+	}
+
+	return GameState(pState, lMoves[move]);
+}
 
-		for (unsigned int m=0; m < lNextStates.size(); m++)
+void Player::HelperLoop(SearchThread &thread)
+{
+	unsigned search_id = 0;
+	std::unique_lock<std::mutex> lock(helperMutex);
+	while (true)
+	{
+		helperWakeUp.wait(lock, [&] { return helpersQuit || helperSearchId != search_id; });
+		if (helpersQuit) return;
+		search_id = helperSearchId;
+
+		lock.unlock();
+		if (useSplitPoints) Player::IdleLoop(thread);
+		else Player::HelperSearch(thread);
+		lock.lock();
+
+		if (--helpersSearching == 0) helperDone.notify_all();
+	}
+}
+
+void Player::HelperSearch(SearchThread &thread)
+{
+	//Different root orders and depths send the helpers into different parts of the tree first,
+	//where they fill the transposition table for the others.
+	GameState &lState = thread.rootState;
+	Move *lMoves = thread.rootMoves;
+	int lNumMoves = thread.numRootMoves;
+	std::rotate(lMoves, lMoves + thread.id % lNumMoves, lMoves + lNumMoves);
+
+	const double infinity = std::numeric_limits<double>::infinity();
+	for (int d = 1 + thread.id % 2; d <= maxDepth; d++)
+	{
+		int iteration_move;
+		Player::SearchRoot(thread, lState, lMoves, lNumMoves, d, -infinity, infinity, iteration_move);
+		if (stopTimer.stopped()) break;
+		std::swap(lMoves[0], lMoves[iteration_move]);
+	}
+}
+
+double Player::SearchRoot(SearchThread &thread, GameState &pState, Move pMoves[], int pNumMoves, int depth, double alpha, double beta, int &bestMove)
+{
+	//A move only becomes the best one once it is known to beat alpha, so the choice is
+	//still sound if the search is stopped halfway.
+	double value = -1 * std::numeric_limits<double>::infinity();
+	bestMove = -1;
+
+	for (int m = 0; m < pNumMoves; m++)
+	{
+		GameState::Undo undo;
+		pState.makeMove(pMoves[m], undo);
+		double child_value;
+		bool researched = false;
+		if (m == 0) child_value = -Player::Negamax(thread, pState, depth - 1, 1, -beta, -alpha);
+		else
 		{
-			float child_value = Player::MiniMaxAB(lNextStates[m], d, alpha, beta, true);
-			if (child_value > value) move = m;
+			//Prove the move worse with a null window, search it properly if it isn't.
+			child_value = -Player::Negamax(thread, pState, depth - 1, 1, -alpha - nullWindow, -alpha);
+			if (child_value > alpha && child_value < beta && !stopTimer.stopped())
+			{
+				researched = true;
+				child_value = -Player::Negamax(thread, pState, depth - 1, 1, -beta, -alpha);
+			}
 		}
+		pState.unmakeMove(pMoves[m], undo);
 
-		//Return move if there is not enough time for the next iteration.
-		double time_left = 0.0;
-		if ((time_left_before - time_left) > time_left) return lNextStates[move];
+		//Unfinished moves can't be trusted, but one that already failed high beats the others.
+		if (stopTimer.stopped())
+		{
+			if (researched) bestMove = m;
+			return value;
+		}
 
-		//Sort children based on their value (highest first).
+		if (child_value > value)
+		{
+			value = child_value;
+			if (value > alpha || bestMove < 0) bestMove = m;
+		}
+		alpha = std::max(value, alpha);
+		if (alpha >= beta) break;
 	}
 
-	//return lNextStates[rand() % lNextStates.size()];
+	return value;
 }
 
-double Player::MiniMaxAB(const GameState &pState, int depth, double alpha, double beta, bool maxPlayer)
+double Player::Negamax(SearchThread &thread, GameState &pState, int depth, int ply, double alpha, double beta)
 {
-	if (!depth) return Player::StaticGameValue(pState);
-	else
+	//Read the clock every few nodes only, and unwind as soon as time is up.
+	++thread.nodes;
+	if (thread.timeCheck.expired()) stopTimer.stop();
+	if (Player::aborted(thread)) return 0.0;
+
+	if (pState.isEOG()) return Player::EndGameValue(pState, ply);
+
+	//Positions with few pieces have a known result.
+	EndgameDatabase::Result known = endgameDatabase.probe(pState);
+	if (known != EndgameDatabase::RESULT_UNKNOWN)
 	{
-		//Initialize value to minus/plus infinity.
-		double value;
-		if (maxPlayer) value = -1 * std::numeric_limits<double>::infinity();
-		else value = std::numeric_limits<double>::infinity();
+		++thread.databaseHits;
+		return Player::DatabaseValue(known);
+	}
 
-		//Get GameState children (possible next moves).
-		std::vector<GameState> lNextStates;
-		pState.findPossibleMoves(lNextStates);
+	//Leaves in the middle of a capture sequence are resolved first.
+	if (!depth) return Player::Quiescence(thread, pState, ply, alpha, beta);
 
-		for (unsigned int i = 0; i < lNextStates.size(); i++)
+	//Check the transposition table: a deep enough result may settle this node,
+	//otherwise its best move is tried first.
+	double alphaOrig = alpha;
+	Move hashMove(Move::MOVE_NULL);
+	TranspositionTable::Entry entry;
+	++thread.tableProbes;
+	if (Player::probeTable(thread, pState.getHash(), entry))
+	{
+		++thread.tableHits;
+		hashMove = entry.getMove();
+		if (entry.mDepth >= depth)
 		{
-			//Get child value
-			double child_value = Player::MiniMaxAB(lNextStates[i], (depth - 1), alpha, beta, !maxPlayer);
+			double entry_value = Player::scoreFromTable(entry.mScore, ply);
+			if (entry.mBound == TranspositionTable::BOUND_EXACT) return entry_value;
+			if (entry.mBound == TranspositionTable::BOUND_LOWER) alpha = std::max(alpha, entry_value);
+			if (entry.mBound == TranspositionTable::BOUND_UPPER) beta = std::min(beta, entry_value);
+			if (beta <= alpha) return entry_value;
+		}
+	}
+	double betaOrig = beta;
 
-			if (maxPlayer)
-			{
-				//Update value and alpha.
-				value = std::max(value, child_value);
-				alpha = std::max(value, alpha);
+	//Frontier nodes evaluate their quiet children together.
+	if (depth == 1 && useBatchEval)
+	{
+		Move bestMove(Move::MOVE_NULL);
+		double value = Player::SearchFrontier(thread, pState, ply, alpha, beta, bestMove);
+		if (Player::aborted(thread)) return 0.0;
+
+		TranspositionTable::Bound bound = TranspositionTable::BOUND_EXACT;
+		if (value <= alphaOrig) bound = TranspositionTable::BOUND_UPPER;
+		else if (value >= betaOrig) bound = TranspositionTable::BOUND_LOWER;
+		Player::storeTable(thread, pState.getHash(), depth, Player::scoreToTable(value, ply), bound, bestMove);
+		return value;
+	}
 
-				//Beta cut-off
-				if (beta <= alpha) break;
-			}
-			else
-			{
-				//Update value and beta.
-				value = std::min(value, child_value);
-				beta = std::min(value, beta);
+	//Selective search is only done in null window nodes, and not when a win or loss is in sight.
+	bool pvNode = (beta - alpha > 2 * nullWindow);
+	bool selective = !pvNode && alpha > -winScore + maxPly && beta < winScore - maxPly;
 
-				//Alpha cut-off
-				if (beta <= alpha) break;
-			}
+	//ProbCut: if a shallow search clears beta by a margin, the full search most likely fails high too.
+	if (useProbCut && selective && depth >= probCutDepth)
+	{
+		double probBeta = beta + probCutMargin;
+		double shallow_value = Player::Negamax(thread, pState, depth - probCutReduction, ply, probBeta - nullWindow, probBeta);
+		if (Player::aborted(thread)) return 0.0;
+		if (shallow_value >= probBeta) return shallow_value;
+	}
+
+	//Initialize value to minus infinity.
+	double value = -1 * std::numeric_limits<double>::infinity();
+
+	//Moves are generated stage by stage; children are only built when visited.
+	Move *lMoves = thread.frameMoves(ply);
+	const Move *plyKillers = (ply < killerPlies) ? thread.killers[ply] : NULL;
+	MovePicker lPicker(pState, lMoves, hashMove, plyKillers, plyKillers ? MovePicker::cMaxKillers : 0, &thread.history);
+
+	//Futility pruning: near the leaves, quiet moves can't bring a position far below alpha back up.
+	double futilityValue = 0.0;
+	bool futile = false;
+	if (useFutility && selective && depth <= futilityDepth && !lPicker.hasCaptures())
+	{
+		futilityValue = Player::StaticGameValue(thread, pState, ply) + futilityMargin * depth;
+		futile = (futilityValue <= alpha);
+	}
 
+	Move lMove;
+	Move bestMove(Move::MOVE_NULL);
+	bool first = true;
+	int searched = 0;
+	while (true)
+	{
+		//Young brothers wait: once the first move is searched, idle threads can help with the others.
+		if (!first && Player::canSplit(thread, depth))
+		{
+			SplitPoint split;
+			split.state = pState;
+			split.picker = &lPicker;
+			split.depth = depth;
+			split.ply = ply;
+			split.futile = futile;
+			split.futilityValue = futilityValue;
+			split.alpha = alpha;
+			split.beta = beta;
+			split.value = value;
+			split.bestMove = bestMove;
+			split.searched = searched;
+			Player::Split(thread, split);
+			if (Player::aborted(thread)) return 0.0;
+			value = split.value;
+			bestMove = split.bestMove;
+			break;
 		}
 
-		return value;
+		if (!lPicker.next(lMove)) break;
+		if (futile && !first && lMove.isNormal())
+		{
+			value = std::max(value, futilityValue);
+			continue;
+		}
+
+		//Principal variation search: the first move gets the full window, the others
+		//a null window, and are searched again only if they turn out better.
+		double child_value;
+		if (first)
+		{
+			GameState::Undo undo;
+			pState.makeMove(lMove, undo);
+			child_value = -Player::Negamax(thread, pState, depth - 1, ply + 1, -beta, -alpha);
+			pState.unmakeMove(lMove, undo);
+		}
+		else child_value = Player::SearchMove(thread, pState, lMove, depth, ply, alpha, beta, searched);
+		if (Player::aborted(thread)) return 0.0;
+		searched++;
+
+		//Update value and alpha.
+		if (child_value > value || bestMove.isNull())
+		{
+			value = child_value;
+			bestMove = lMove;
+		}
+		alpha = std::max(value, alpha);
+
+		//Beta cut-off: remember the move for ordering siblings and later searches.
+		if (alpha >= beta)
+		{
+			++thread.cutoffs;
+			if (first) ++thread.firstMoveCutoffs;
+			thread.recordCutoff(lMove, depth, ply);
+			break;
+		}
+		first = false;
 	}
+
+	//Store the result with the window it was searched with.
+	TranspositionTable::Bound bound = TranspositionTable::BOUND_EXACT;
+	if (value <= alphaOrig) bound = TranspositionTable::BOUND_UPPER;
+	else if (value >= betaOrig) bound = TranspositionTable::BOUND_LOWER;
+	Player::storeTable(thread, pState.getHash(), depth, Player::scoreToTable(value, ply), bound, bestMove);
+
+	return value;
 }
 
-double Player::StaticGameValue(const GameState &pState)
+double Player::SearchMove(SearchThread &thread, GameState &pState, const Move &pMove, int depth, int ply, double alpha, double beta, int searched)
 {
-	//Score should equal to 1 if the game state is a victory :)
-	if (color == 1 && pState.isRedWin()) return 1.0;
-	else if (color == -1 && pState.isWhiteWin()) return 1.0;
+	GameState::Undo undo;
+	pState.makeMove(pMove, undo);
+
+	//Late move reductions: quiet moves late in the ordering are first searched one ply less,
+	//unless they give the opponent a jump.
+	double child_value;
+	bool reduced = useReductions && depth >= reductionDepth && searched >= reductionMoves &&
+	               pMove.isNormal() && !pState.hasCaptures();
+	if (reduced) child_value = -Player::Negamax(thread, pState, depth - 2, ply + 1, -alpha - nullWindow, -alpha);
+	if (!reduced || child_value > alpha) child_value = -Player::Negamax(thread, pState, depth - 1, ply + 1, -alpha - nullWindow, -alpha);
+	if (child_value > alpha && child_value < beta) child_value = -Player::Negamax(thread, pState, depth - 1, ply + 1, -beta, -alpha);
+
+	pState.unmakeMove(pMove, undo);
+	return child_value;
+}
 
-	//Check hash table to see if this value has already been computed before.
+bool Player::aborted(const SearchThread &thread)
+{
+	if (stopTimer.stopped()) return true;
+	int index = thread.activeIndex;
+	for (const SplitPoint *split = thread.activeSplit; split; index = split->parentIndex, split = split->parent)
+		if (split->cutoff.load(std::memory_order_relaxed) < index) return true;
+	return false;
+}
 
-	//Points awarded for regular pieces (zero-zum).
-	//Points for regular pieces stored at index 0.
-	//Points for king pieces stored at index 1.
-	int materialPoints[2];
-	Player::materialValue(pState, materialPoints);
+bool Player::canSplit(const SearchThread &thread, int depth)
+{
+	if (!useSplitPoints || depth < splitDepth) return false;
+	if (reproducibleSplits)
+	{
+		int level = thread.activeSplit ? thread.activeSplit->level + 1 : 0;
+		return level < maxSplitPoints;
+	}
+	return idleHelpers.load(std::memory_order_relaxed) > 0 && thread.numSplitPoints < maxSplitPoints;
+}
 
-	//Moves left until draw.
-	int movesLeft = (int)pState.getMovesUntilDraw();
+TranspositionTable &Player::currentTable(SearchThread &thread)
+{
+	return reproducibleSplits && thread.taskLevel ? thread.taskTables[thread.taskLevel - 1] : transpositionTable;
+}
 
-	//Available moves.
-	std::vector<GameState> lNextStates;
-	pState.findPossibleMoves(lNextStates);
-	int availableMoves = lNextStates.size();
+bool Player::probeTable(SearchThread &thread, uint64_t key, TranspositionTable::Entry &entry)
+{
+	if (!reproducibleSplits || !thread.taskLevel) return transpositionTable.probe(key, entry);
+	if (thread.taskTables[thread.taskLevel - 1].probe(key, entry)) return true;
+	for (const SplitPoint *split = thread.activeSplit; split; split = split->parent)
+		if (split->table->probe(key, entry)) return true;
+	return false;
+}
 
-	//Heuristic (linear polynomial).
-	return B0 + B1 * color * materialPoints[0] + B2 * color * materialPoints[1] + B3 * movesLeft + B4 * availableMoves;
+void Player::storeTable(SearchThread &thread, uint64_t key, int depth, double score, TranspositionTable::Bound bound, const Move &move)
+{
+	Player::currentTable(thread).store(key, depth, score, bound, move);
 }
 
-void Player::materialValue(const GameState &pState, int materialPoints[])
+void Player::Split(SearchThread &thread, SplitPoint &split)
 {
+	//Offer the split point to the other threads, and search moves of it like they do.
+	//The picker orders the moves it has yet to generate with a copy of the history.
+	std::copy(&thread.history[0][0], &thread.history[0][0] + GameState::cSquares * GameState::cSquares, &split.history[0][0]);
+	split.picker->setHistory(&split.history);
+	split.parent = thread.activeSplit;
+	split.parentIndex = thread.activeIndex;
+	split.level = split.parent ? split.parent->level + 1 : 0;
+	if (reproducibleSplits)
+	{
+		std::copy(&thread.killers[0][0], &thread.killers[0][0] + killerPlies * MovePicker::cMaxKillers, &split.killers[0][0]);
+		split.table = &Player::currentTable(thread);
+	}
+	{
+		std::lock_guard<std::mutex> lock(thread.splitMutex);
+		assert(thread.numSplitPoints < maxSplitPoints);
+		thread.splitPoints[thread.numSplitPoints++] = &split;
+	}
+
+	uint64_t nodes = thread.nodes;
+	Player::SearchSplitPoint(thread, split);
+
+	//Withdraw it, then help the threads that joined it (they can't find it anymore) with the split points
+	//they created below it, until they have all left.
+	{
+		std::lock_guard<std::mutex> lock(thread.splitMutex);
+		thread.numSplitPoints--;
+	}
+	while (split.workers.load())
+	{
+		SplitPoint *joined = Player::joinSplitPoint(thread, &split);
+		if (!joined)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		Player::SearchSplitPoint(thread, *joined);
+		joined->workers--;
+	}
+	if (!reproducibleSplits) return;
+
+	//The owner's move ordering goes back to where it was before it searched moves of the split point.
+	std::copy(&split.history[0][0], &split.history[0][0] + GameState::cSquares * GameState::cSquares, &thread.history[0][0]);
+	std::copy(&split.killers[0][0], &split.killers[0][0] + killerPlies * MovePicker::cMaxKillers, &thread.killers[0][0]);
+
+	//Count the nodes of the moves up to the first cut-off, which a search one move after the other would
+	//have searched too (all of those handed out once stopped, the count is not reproducible then anyway).
+	int last = std::min(split.handedOut - 1, split.cutoff.load());
+	if (stopTimer.stopped()) last = split.handedOut - 1;
+	thread.nodes = nodes;
+	for (int i = 0; i <= last; i++) thread.nodes += split.nodes[i];
+	if (Player::aborted(thread)) return;
+
+	for (int i = 0; i <= last; i++)
+	{
+		if (split.values[i] > split.value)
+		{
+			split.value = split.values[i];
+			split.bestMove = split.moves[i];
+		}
+	}
+	if (last == split.cutoff)
+	{
+		++thread.cutoffs;
+		thread.recordCutoff(split.moves[last], split.depth, split.ply);
+	}
+}
 
-	//There are 31 cells in the board.
-	for (int i = 0; i < 31; i++)
+void Player::SearchSplitPoint(SearchThread &thread, SplitPoint &split)
+{
+	//Each thread makes moves on its own copy of the position; the owner's stays as it is for the picker.
+	GameState lState = split.state;
+	SplitPoint *outer = thread.activeSplit;
+	int outerIndex = thread.activeIndex;
+	thread.activeSplit = &split;
+	thread.activeIndex = -1;
+	if (reproducibleSplits) thread.taskLevel++;
+
+	std::unique_lock<std::mutex> lock(split.mutex);
+	Move lMove;
+	while (split.open && !Player::aborted(thread))
 	{
+		if (!split.picker->next(lMove))
+		{
+			split.open = false;
+			break;
+		}
+		if (split.futile && lMove.isNormal())
+		{
+			split.value = std::max(split.value, split.futilityValue);
+			continue;
+		}
+
+		//The window is read again for every move: the others may have raised alpha meanwhile.
+		int index = split.handedOut++;
+		split.moves[index] = lMove;
+		double alpha = split.alpha;
+		lock.unlock();
+		thread.activeIndex = index;
+		uint64_t nodes = thread.nodes;
+		if (reproducibleSplits)
+		{
+			//Every move is searched with the window of the split point, from the owner's move ordering and with
+			//an empty table, so its result and nodes are the same whichever thread searches it, whenever.
+			std::copy(&split.history[0][0], &split.history[0][0] + GameState::cSquares * GameState::cSquares, &thread.history[0][0]);
+			std::copy(&split.killers[0][0], &split.killers[0][0] + killerPlies * MovePicker::cMaxKillers, &thread.killers[0][0]);
+			Player::currentTable(thread).forget();
+		}
+		double child_value = Player::SearchMove(thread, lState, lMove, split.depth, split.ply, alpha, split.beta, split.searched + index);
+		bool unwound = Player::aborted(thread);
+		thread.activeIndex = -1;
+		lock.lock();
+
+		if (reproducibleSplits)
+		{
+			//The nodes are counted by Split, for the moves it keeps.
+			split.nodes[index] = thread.nodes - nodes;
+			thread.nodes = nodes;
+			if (unwound) break;
+			split.values[index] = child_value;
+
+			//Beta cut-off: the moves handed out after this one unwind, and no more are handed out.
+			if (child_value >= split.beta)
+			{
+				if (index < split.cutoff) split.cutoff = index;
+				split.open = false;
+			}
+			continue;
+		}
+		if (unwound) break;
+
+		if (child_value > split.value)
+		{
+			split.value = child_value;
+			split.bestMove = lMove;
+		}
+		split.alpha = std::max(split.value, split.alpha);
+
+		//Beta cut-off: every thread still searching a move of the split point unwinds.
+		if (split.alpha >= split.beta)
+		{
+			split.cutoff = -1;
+			split.open = false;
+			++thread.cutoffs;
+			thread.recordCutoff(lMove, split.depth, split.ply);
+			break;
+		}
+	}
+	lock.unlock();
+
+	thread.activeSplit = outer;
+	thread.activeIndex = outerIndex;
+	if (reproducibleSplits) thread.taskLevel--;
+}
+
+Player::SplitPoint *Player::joinSplitPoint(SearchThread &thread, const SplitPoint *below)
+{
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		SearchThread &owner = *threads[t];
+		if (&owner == &thread) continue;
+		std::lock_guard<std::mutex> lock(owner.splitMutex);
+		for (int i = 0; i < owner.numSplitPoints; i++)
+		{
+			SplitPoint *split = owner.splitPoints[i];
+			if (!split->open) continue;
+			if (below)
+			{
+				const SplitPoint *above = split->parent;
+				while (above && above != below) above = above->parent;
+				if (!above) continue;
+			}
+			split->workers++;
+			return split;
+		}
+	}
+	return NULL;
+}
+
+void Player::IdleLoop(SearchThread &thread)
+{
+	++idleHelpers;
+	while (!stopTimer.stopped())
+	{
+		//Join the shallowest open split point found, it has the most work left.
+		SplitPoint *joined = Player::joinSplitPoint(thread, NULL);
+		if (!joined)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		--idleHelpers;
+		Player::SearchSplitPoint(thread, *joined);
+		joined->workers--;
+		++idleHelpers;
+	}
+	--idleHelpers;
+}
+
+double Player::SearchFrontier(SearchThread &thread, GameState &pState, int ply, double alpha, double beta, Move &bestMove)
+{
+	//Children with jumps to make or a finished game are searched one by one as usual,
+	//quiet ones are queued and evaluated in batches (unless found in evalCache, with useEvalCache).
+	//Children found in endgameDatabase take its result, as in Negamax.
+	//Nothing is pruned: leaves are cheap.
+	Move *lMoves = thread.frameMoves(ply);
+	int lNumMoves = pState.findPossibleMoves(lMoves);
+	int batchMoves[EvalBatch::cMaxSize];
+	uint64_t batchKeys[EvalBatch::cMaxSize];
+	EvalBatch batch;
+
+	double value = -1 * std::numeric_limits<double>::infinity();
+	for (int m = 0; m < lNumMoves && alpha < beta; m++)
+	{
+		++thread.nodes;
+		if (thread.timeCheck.expired()) stopTimer.stop();
+		if (Player::aborted(thread)) return 0.0;
+
+		GameState::Undo undo;
+		pState.makeMove(lMoves[m], undo);
+		bool quiet = !pState.isEOG() && pState.getMovesUntilDraw() > 0 && !pState.hasCaptures();
+		bool batched = false;
+		double child_value = 0.0;
+		uint64_t key = useEvalCache ? Player::evalCacheKey(pState) : 0;
+		EndgameDatabase::Result known = endgameDatabase.probe(pState);
+		if (known != EndgameDatabase::RESULT_UNKNOWN)
+		{
+			++thread.databaseHits;
+			child_value = -Player::DatabaseValue(known);
+		}
+		else if (quiet && useEvalCache && Player::probeEvalCache(thread, key, child_value)) child_value = -child_value;
+		else if (quiet)
+		{
+			int i = batch.add(pState);
+			batchMoves[i] = m;
+			batchKeys[i] = key;
+			batched = true;
+		}
+		else if (pState.isEOG()) child_value = -Player::EndGameValue(pState, ply + 1);
+		else child_value = -Player::Quiescence(thread, pState, ply + 1, -beta, -alpha);
+		pState.unmakeMove(lMoves[m], undo);
+		if (Player::aborted(thread)) return 0.0;
 
-		//If the cell is occupied by white, increment points.
-		if (pState.at(i)&CELL_RED)
+		if (!batched && child_value > value)
 		{
-			if (pState.at(i)&CELL_KING) materialPoints[1] += 1;
-			else materialPoints[0] += 1;
+			value = child_value;
+			bestMove = lMoves[m];
+			alpha = std::max(value, alpha);
 		}
-		//If the piece belongs to the oponent, substract points as appropiate.
-		else if (pState.at(i)&CELL_WHITE)
+
+		//Children all have the opponent to move.
+		if (batch.full() || (m == lNumMoves - 1 && batch.size()))
 		{
-			if (pState.at(i)&CELL_KING) materialPoints[1] -= 1;
-			else materialPoints[0] -= 1;
+			batch.evaluate();
+			int side = (pState.getNextPlayer() == CELL_RED) ? -1 : 1;
+			for (int i = 0; i < batch.size(); i++)
+			{
+				int childMoves = (side == 1) ? batch.getRedMoves(i) : batch.getWhiteMoves(i);
+				int otherMoves = (side == 1) ? batch.getWhiteMoves(i) : batch.getRedMoves(i);
+				int materialPoints[2] = {batch.getMen(i), batch.getKingCount(i)};
+				if (childMoves)
+				{
+					double static_value = Player::TermsValue(side, materialPoints, childMoves - otherMoves, batch.getPieceSquare(i), batch.getMovesUntilDraw(i));
+					if (useEvalCache) evalCache.store(batchKeys[i], static_value);
+					child_value = -static_value;
+				}
+				else child_value = winScore - (ply + 2); //The child can't move, and loses on the next ply
+				if (child_value > value)
+				{
+					value = child_value;
+					bestMove = lMoves[batchMoves[i]];
+					alpha = std::max(value, alpha);
+				}
+			}
+			batch.clear();
 		}
 	}
 
+	if (alpha >= beta)
+	{
+		++thread.cutoffs;
+		thread.recordCutoff(bestMove, 1, ply);
+	}
+	return value;
+}
+
+Move *Player::SearchThread::frameMoves(int ply)
+{
+	assert(ply >= 0 && ply < stackPlies);
+	return searchStack[ply].moves;
+}
+
+void Player::SearchThread::recordCutoff(const Move &pMove, int depth, int ply)
+{
+	//Killers and history only hold normal moves, jumps are forced anyway.
+	if (!pMove.isNormal()) return;
+	if (ply < killerPlies && !(killers[ply][0] == pMove))
+	{
+		for (int k = MovePicker::cMaxKillers - 1; k > 0; k--) killers[ply][k] = killers[ply][k - 1];
+		killers[ply][0] = pMove;
+	}
+	history[pMove[0]][pMove[1]] += depth * depth;
+}
+
+double Player::Quiescence(SearchThread &thread, GameState &pState, int ply, double alpha, double beta)
+{
+	//Stand pat: without a jump to make the position is quiet.
+	Move *lCaptures = thread.frameMoves(ply);
+	int lNumCaptures = 0;
+	if (!pState.isEOG() && pState.getMovesUntilDraw() > 0) lNumCaptures = pState.findCaptures(lCaptures);
+	if (!lNumCaptures) return Player::StaticGameValue(thread, pState, ply);
+
+	//Initialize value to minus infinity.
+	double value = -1 * std::numeric_limits<double>::infinity();
+
+	for (int i = 0; i < lNumCaptures; i++)
+	{
+		++thread.nodes;
+		if (thread.timeCheck.expired()) stopTimer.stop();
+		if (Player::aborted(thread)) return 0.0;
+
+		GameState::Undo undo;
+		pState.makeMove(lCaptures[i], undo);
+		double child_value = -Player::Quiescence(thread, pState, ply + 1, -beta, -alpha);
+		pState.unmakeMove(lCaptures[i], undo);
+		if (Player::aborted(thread)) return 0.0;
+
+		value = std::max(value, child_value);
+		alpha = std::max(value, alpha);
+		if (alpha >= beta) break;
+	}
+
+	return value;
+}
+
+double Player::DatabaseValue(EndgameDatabase::Result known)
+{
+	if (known == EndgameDatabase::RESULT_WIN) return databaseWinScore;
+	if (known == EndgameDatabase::RESULT_LOSS) return -databaseWinScore;
+	return 0.0;
+}
+
+bool Player::IsForced(const GameState &pState, int numMoves)
+{
+	return numMoves <= solverMaxMoves || pState.hasCaptures() ||
+	       popCount(pState.getRedPieces() | pState.getWhitePieces()) <= solverMaxPieces;
+}
+
+double Player::EndGameValue(const GameState &pState, int ply)
+{
+	//Prefer the quickest win and the slowest loss.
+	if (pState.isDraw()) return 0.0;
+	bool moverWon = (pState.isRedWin() && pState.getNextPlayer() == CELL_RED) ||
+	                (pState.isWhiteWin() && pState.getNextPlayer() == CELL_WHITE);
+	return moverWon ? winScore - ply : -winScore + ply;
+}
+
+double Player::scoreToTable(double value, int ply)
+{
+	//Won and lost scores are stored relative to the node instead of the root.
+	if (value >= winScore - maxPly) return value + ply;
+	if (value <= -winScore + maxPly) return value - ply;
+	return value;
+}
+
+double Player::scoreFromTable(double value, int ply)
+{
+	if (value >= winScore - maxPly) return value - ply;
+	if (value <= -winScore + maxPly) return value + ply;
+	return value;
+}
+
+uint64_t Player::evalCacheKey(const GameState &pState)
+{
+	return pState.getHash() ^ (pState.getMovesUntilDraw() * 0x9E3779B97F4A7C15ull);
+}
+
+bool Player::probeEvalCache(SearchThread &thread, uint64_t key, double &value)
+{
+	++thread.evalCacheProbes;
+	if (!evalCache.probe(key, value)) return false;
+	++thread.evalCacheHits;
+	return true;
+}
+
+double Player::StaticGameValue(SearchThread &thread, const GameState &pState, int ply)
+{
+	//Scores are from the point of view of the side to move.
+	if (pState.isEOG()) return Player::EndGameValue(pState, ply);
+	if (pState.getMovesUntilDraw() <= 0) return 0.0;
+
+	//Check hash table to see if this value has already been computed before.
+	uint64_t key = Player::evalCacheKey(pState);
+	double value;
+	if (useEvalCache && Player::probeEvalCache(thread, key, value)) return value;
+
+	//Available moves, compared with those of the opponent (a side that can't move has lost, on the next ply).
+	uint8_t opponent = pState.getNextPlayer() ^ (CELL_RED | CELL_WHITE);
+	int ownMoves = pState.countNormalMoves(pState.getNextPlayer());
+	if (!ownMoves && !pState.hasCaptures()) return -winScore + ply + 1;
+	int availableMoves = ownMoves - pState.countNormalMoves(opponent);
+
+	//Points awarded for regular pieces (zero-zum).
+	//Points for regular pieces stored at index 0.
+	//Points for king pieces stored at index 1.
+	int materialPoints[2] = {0, 0};
+	Player::materialValue(pState, materialPoints);
+	int side = (pState.getNextPlayer() == CELL_RED) ? 1 : -1;
+
+	//The piece-square sum is kept up to date by the GameState.
+	value = Player::TermsValue(side, materialPoints, availableMoves, pState.getPieceSquare(), pState.getMovesUntilDraw());
+	if (useEvalCache) evalCache.store(key, value);
+	return value;
+}
+
+double Player::TermsValue(int side, const int materialPoints[], int availableMoves, int pieceSquare, int movesLeft)
+{
+	double material = B1 * side * materialPoints[0] + B2 * side * materialPoints[1];
+
+	//Moves left until draw: the side ahead wants to make progress before the game is drawn.
+	double progress = 0.0;
+	if (material > 0) progress = B3 * movesLeft;
+	else if (material < 0) progress = -B3 * movesLeft;
+
+	//Heuristic (linear polynomial).
+	return B0 + material + progress + B4 * availableMoves + B5 * side * pieceSquare;
+}
+
+void Player::materialValue(const GameState &pState, int materialPoints[])
+{
+	//Count pieces on the red and white masks (red is positive, white negative).
+	int redKings = pState.countKings(CELL_RED);
+	int whiteKings = pState.countKings(CELL_WHITE);
+	materialPoints[0] = (pState.countPieces(CELL_RED) - redKings) - (pState.countPieces(CELL_WHITE) - whiteKings);
+	materialPoints[1] = redKings - whiteKings;
 }
 
 /*namespace checkers*/ }
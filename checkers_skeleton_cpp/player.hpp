@@ -5,6 +5,18 @@
 #include "deadline.hpp"
 #include "move.hpp"
 #include "gamestate.hpp"
+#include "movepicker.hpp"
+#include "transposition.hpp"
+#include "stoptimer.hpp"
+#include "evalbatch.hpp"
+#include "evalcache.hpp"
+#include "egdb.hpp"
+#include "pnsolver.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace checkers
@@ -13,30 +25,323 @@ namespace checkers
 class Player
 {
 public:
+	Player();
+	~Player();
+
     ///perform a move
     ///\param pState the current state of the board
     ///\param pDue time before which we must have returned
     ///\return the next state the board is in after our move
     GameState play(const GameState &pState, const Deadline &pDue);
 
-	//Player's color (1 for red, -1 for white).
-	int color;
+	//Pondering: searches pState, the position after our move, on a background thread while the opponent
+	//thinks, until stopPondering() is called. The results are left in the transposition table, where the
+	//next call to play() finds them for whichever reply the opponent chose.
+	void startPondering(const GameState &pState);
+	void stopPondering(); //Does nothing if not pondering
+
+	//Search results, kept across calls to play() (scores are from the point of view of the side to move).
+	//Shared by all search threads.
+	TranspositionTable transpositionTable;
+
+	//Static values, kept across calls to play().
+	EvalCache evalCache;
+	bool useEvalCache = false; //Look up static values in evalCache before computing them (off by default: the
+	                           //incremental evaluation is cheaper than a lookup that mostly misses)
+
+	//Win/loss/draw results of the positions with few pieces, looked up during the search (none until opened).
+	EndgameDatabase endgameDatabase;
+
+	//Proof-number solver, tried before the alpha-beta search in forced positions (see IsForced). What it
+	//proves is kept across calls to play(), and a proven win is played without searching.
+	ProofNumberSolver solver;
+	bool useSolver = true;
+	const double solverShare = 0.1; //Fraction of the time left given to the solver
+	const double solverMaxTime = 0.5; //Most seconds given to the solver (pondering has no real deadline)
+	const int solverMaxMoves = 2; //Positions with at most this many moves are forced
+	const int solverMaxPieces = 6; //So are positions with at most this many pieces (races to promotion)
+
+	//Time control
+	int maxDepth = 64; //Deepest iteration of iterative deepening
+	const int maxPly = 1000; //More plies than any search can reach (bounds the distance to a win)
+	const double timeMargin = 0.05; //Fraction of the time budget kept as a safety margin
+	double stopMargin = 0.02; //Minimum safety margin in seconds
+	const double iterationShare = 0.55; //A new iteration only starts while less than this share of the time is used
+	const unsigned nodesPerTimeCheck = 1024; //Nodes searched between two reads of the clock
+	Deadline stopTime; //The search is aborted when this time is reached
+	StopTimer stopTimer; //Raised at stopTime by a timer thread (or by a search thread); results after that are meaningless
+	const double ponderLimit = 3600.0; //Seconds after which pondering stops on its own
+	std::thread ponderThread; //Runs Think while pondering
+
+	//Selective search (each part can be switched off)
+	bool useReductions = true; //Late move reductions
+	const int reductionDepth = 3; //Least remaining depth where moves are reduced
+	const int reductionMoves = 3; //Moves searched in full before the others are reduced
+	bool useFutility = true; //Futility pruning
+	const int futilityDepth = 2; //Greatest remaining depth where moves are pruned
+	const double futilityMargin = 1.0; //Gain assumed possible per remaining ply
+	bool useProbCut = false; //ProbCut (off by default, it hasn't paid off in self-play so far)
+	const int probCutDepth = 5; //Least remaining depth where ProbCut is tried
+	const int probCutReduction = 3; //Plies less for the shallow search
+	const double probCutMargin = 0.5; //Margin above beta the shallow search must clear
+
+	bool useBatchEval = true; //Evaluate the quiet children of frontier nodes together (see EvalBatch)
+
+	//Parallel search
+	bool useSplitPoints = false; //Helpers join split points (YBWC) instead of searching on their own (Lazy SMP)
+	bool reproducibleSplits = false; //YBWC searches the same nodes whatever the number of threads (slower, see SplitPoint)
+	const int splitDepth = 4; //Least remaining depth of a split point
+	static const int maxSplitPoints = 16; //Split points nested in one another (so also owned by a thread at once)
+	const std::size_t taskTableMegabytes = 1; //Size of each table of a thread for moves of split points
+
+	static const int killerPlies = 64; //Plies that have killer moves
+	static const int stackPlies = 128; //More plies than the search and the capture sequences below it can reach
+
+	//Move buffers of one ply of the search stack.
+	struct SearchFrame
+	{
+		Move moves[GameState::cMaxMoves];
+	};
+
+	//Young brothers wait (YBWC): once the first move of a node has been searched, the remaining ones can be
+	//searched by several threads. The split point holds what they share; it lives on the stack of the thread
+	//that created it (its owner), which searches moves like the others and then helps them until they leave.
+	//The threads share alpha and the transposition table, and a beta cut-off stops all of them.
+	//With reproducibleSplits, the same nodes split whatever the number of threads (one included) and each move
+	//is searched with the split point's window, move ordering and tables only, so a search to a fixed depth
+	//visits the same nodes every time, at the cost of several times the nodes (see SearchSplitPoint).
+	struct SplitPoint
+	{
+		std::mutex mutex; //Guards the picker and the results below
+		GameState state; //Position of the node, copied by every thread that searches moves of it
+		MovePicker *picker = NULL; //Remaining moves (the owner's, built on the owner's position)
+		int depth = 0;
+		int ply = 0;
+		int level = 0; //Split points it is nested in
+		bool futile = false; //Quiet moves are pruned, see Negamax
+		double futilityValue = 0.0;
+
+		//Move ordering of the owner when it split: the picker orders the moves it hasn't generated yet with
+		//the history (with reproducibleSplits, every move is also searched starting from both)
+		MovePicker::History history;
+		Move killers[killerPlies][MovePicker::cMaxKillers]; //reproducibleSplits only
+		TranspositionTable *table = NULL; //Table the owner stored its results in (reproducibleSplits only)
+
+		//Search window and results, updated as the moves are searched (with reproducibleSplits,
+		//the window stays as it was and the results are gathered by the owner once all moves are done)
+		double alpha = 0.0;
+		double beta = 0.0;
+		double value = 0.0;
+		Move bestMove;
+		int searched = 0; //Moves searched before splitting (for late move reductions)
+
+		//Moves handed out, in order, with their values and the nodes searched for them (reproducibleSplits only)
+		Move moves[GameState::cMaxMoves];
+		double values[GameState::cMaxMoves];
+		uint64_t nodes[GameState::cMaxMoves];
+		int handedOut = 0;
+
+		//Index of the first move with a beta cut-off: the moves handed out after it unwind
+		//(-1 without reproducibleSplits, all of them unwind)
+		std::atomic<int> cutoff{GameState::cMaxMoves};
+		std::atomic<bool> open{true}; //Cleared once no moves are left to hand out
+		std::atomic<int> workers{0}; //Threads other than the owner searching moves of it
+		SplitPoint *parent = NULL; //Split point the owner was searching a move of, if any
+		int parentIndex = -1; //Index of that move in parent
+	};
+
+	//Everything one search thread writes, apart from the shared transposition table, evaluation cache and stopTimer.
+	//Lazy SMP: helper threads search the same root as the thread calling play(), with their own move ordering,
+	//and only help it through the entries they leave in the transposition table.
+	//YBWC: helper threads wait for split points to join.
+	struct SearchThread
+	{
+		int id = 0; //0 for the thread calling play(), 1 and up for the helpers
+
+		//Move ordering
+		Move killers[killerPlies][MovePicker::cMaxKillers]; //Last normal moves that caused a beta cut-off, per ply
+		MovePicker::History history = {}; //Normal moves scored by the cut-offs they caused, halved at every call to play()
+
+		//Search stack: a move buffer for every ply, allocated once and reused by all searches,
+		//so that searching doesn't touch the heap.
+		std::vector<SearchFrame> searchStack = std::vector<SearchFrame>(stackPlies);
+
+		DeadlineCheck timeCheck; //Checks stopTime once every nodesPerTimeCheck nodes
+
+		//Root of the search (helpers only, the thread calling play() uses its own)
+		GameState rootState;
+		Move rootMoves[GameState::cMaxMoves];
+		int numRootMoves = 0;
+
+		//Statistics of the last call to play()
+		uint64_t nodes = 0;
+		uint64_t cutoffs = 0;
+		uint64_t firstMoveCutoffs = 0;
+		uint64_t tableProbes = 0;
+		uint64_t tableHits = 0;
+		uint64_t evalCacheProbes = 0;
+		uint64_t evalCacheHits = 0;
+		uint64_t databaseHits = 0;
+
+		std::thread thread; //Runs HelperLoop (helpers only)
+
+		//Split points owned by the thread, as a work-stealing deque: the owner adds and removes them at
+		//the back (the deepest), other threads look for work from the front (the shallowest, largest).
+		std::mutex splitMutex; //Guards splitPoints and numSplitPoints
+		SplitPoint *splitPoints[maxSplitPoints];
+		int numSplitPoints = 0;
+		SplitPoint *activeSplit = NULL; //Split point the thread is searching a move of, NULL outside of one
+		int activeIndex = -1; //Index of that move in activeSplit, -1 between two moves
+
+		//With reproducibleSplits, results of the moves of split points being searched, one table for each split
+		//point the thread is in (allocated by Think the first time it is used). A move starts with an empty table,
+		//and also finds what the owners of the split points above it stored before splitting, which no thread
+		//changes meanwhile. The shared table is only written outside of split points, where no other thread searches.
+		std::vector<TranspositionTable> taskTables;
+		int taskLevel = 0; //Split points the thread is in (taskTables[taskLevel - 1] is in use)
+
+		//Move buffer of the search stack for a node ply plies from the root.
+		//Only one node of each ply is being searched at a time, so the buffer is free to use.
+		Move *frameMoves(int ply);
+
+		//Updates the killer moves and history after pMove caused a beta cut-off.
+		void recordCutoff(const Move &pMove, int depth, int ply);
+	};
+
+	//Search threads, the first one is the thread calling play().
+	std::vector<std::unique_ptr<SearchThread>> threads;
+
+	//Sets the number of search threads (1 searches alone); not to be called during play().
+	void setThreads(int count);
+
+	//Statistics of the last call to play(), summed over the search threads
+	uint64_t nodes = 0; //Nodes searched
+	uint64_t cutoffs = 0; //Nodes with a beta cut-off
+	uint64_t firstMoveCutoffs = 0; //Nodes with a beta cut-off on the first move searched (not counted at frontier nodes)
+	uint64_t tableProbes = 0; //Transposition table lookups
+	uint64_t tableHits = 0; //Transposition table lookups that found the position
+	uint64_t evalCacheProbes = 0; //Evaluation cache lookups (only with useEvalCache)
+	uint64_t evalCacheHits = 0; //Evaluation cache lookups that found the position
+	uint64_t databaseHits = 0; //Nodes settled by the endgame database
+	int completedDepth = 0; //Deepest fully searched iteration
+	int solved = 0; //1 if the solver proved the position won, -1 if lost, 0 if it proved nothing (or didn't run)
+	uint64_t solverNodes = 0; //Positions searched by the solver
+	double score = 0.0; //Score of the deepest fully searched iteration
+
+	//Search windows
+	const double aspirationWindow = 0.25; //Half width of the first window around the score of the last iteration
+	const double nullWindow = 0.001; //Width of the windows used to prove a move is not better
 
 	//Scoring parameters
 	const double B0 = 0.0; //Constant
 	const double B1 = 1.0; //Pawn pieces
 	const double B2 = 2.0; //King pieces
 	const double B3 = 0.02; //Moves until draw
-	const double B4 = 0.1; //Available moves
+	const double B4 = 0.1; //Available moves (more than the opponent)
+	const double B5 = 0.01; //Piece-square sum (hundredths of a pawn)
+
+	const double winScore = 10000.0; //Won game, less the plies needed to win it
+	const double databaseWinScore = 5000.0; //Position won according to the endgame database (the win is not
+	                                        //played out, so it is below the scores of wins found by the search)
+
+	//Scoring function, from the point of view of the side to move, ply plies away from the root
+	//(finished and blocked games score like EndGameValue). Looked up in evalCache with useEvalCache.
+	double StaticGameValue(SearchThread &thread, const GameState &pState, int ply);
+
+	//Key of pState in evalCache: the moves until draw count in the score but not in the position hash.
+	uint64_t evalCacheKey(const GameState &pState);
+
+	//Looks up key in evalCache, counting the probe for thread.
+	bool probeEvalCache(SearchThread &thread, uint64_t key, double &value);
 
-	//Scoring function
-	double StaticGameValue(const GameState &pState);
+	//Scoring function applied to the terms of a position (counted for red), for side (1 red, -1 white).
+	double TermsValue(int side, const int materialPoints[], int availableMoves, int pieceSquare, int movesLeft);
+
+	//Score of a finished game for the side to move, ply plies away from the root.
+	double EndGameValue(const GameState &pState, int ply);
+
+	//Score of a position with the result known from endgameDatabase, for the side to move.
+	double DatabaseValue(EndgameDatabase::Result known);
+
+	//Conversion of won/lost scores between the root (search) and the node (transposition table).
+	double scoreToTable(double value, int ply);
+	double scoreFromTable(double value, int ply);
 
 	//Points awarded for material (zero-sum).
 	void materialValue(const GameState &pState, int materialPoints[]);
 
-	//MiniMax algorithm with Alpha Beta pruning.
-	double MiniMaxAB(const GameState &pState, int depth, double alpha, double beta, bool maxPlayer);
+	//True if pState (with numMoves moves) looks tactically forced: a capture is due, there are few moves or few pieces.
+	bool IsForced(const GameState &pState, int numMoves);
+
+	//Iterative deepening search of the moves of pState, until stopTimer is raised (which play() and
+	//startPondering() arm). Returns the state after the best move found.
+	GameState Think(const GameState &pState);
+
+	//Searches the root moves with principal variation search.
+	//bestMove receives the index of the best move (which beat alpha, or the first one), or -1 if stopped before it.
+	double SearchRoot(SearchThread &thread, GameState &pState, Move pMoves[], int pNumMoves, int depth, double alpha, double beta, int &bestMove);
+
+	//Negamax algorithm with Alpha Beta pruning and principal variation search.
+	//pState is changed with makeMove while searching and restored before returning.
+	//Returns immediately, with a meaningless value, once stopTimer is raised.
+	double Negamax(SearchThread &thread, GameState &pState, int depth, int ply, double alpha, double beta);
+
+	//Principal variation search of pMove, the searched-th move tried at a node after the first,
+	//with late move reductions. Returns the value of the move for the node.
+	double SearchMove(SearchThread &thread, GameState &pState, const Move &pMove, int depth, int ply, double alpha, double beta, int searched);
+
+	//True once the search of thread has to unwind: stopTimer is raised, or a split point it is working for cut off.
+	bool aborted(const SearchThread &thread);
+
+	//True if the node being searched by thread should become a split point: when a helper is idle, or
+	//with reproducibleSplits at every node deep enough (even with one thread, so that the same nodes split every time).
+	bool canSplit(const SearchThread &thread, int depth);
+
+	//Table thread stores its results in: transpositionTable, unless it is in split points with reproducibleSplits.
+	TranspositionTable &currentTable(SearchThread &thread);
+
+	//Looks up and stores search results of thread: probeTable looks in the current table, then in the tables of
+	//the split points above it (so it never finds what another thread stored during the same search).
+	bool probeTable(SearchThread &thread, uint64_t key, TranspositionTable::Entry &entry);
+	void storeTable(SearchThread &thread, uint64_t key, int depth, double score, TranspositionTable::Bound bound, const Move &move);
+
+	//Searches the remaining moves of split with the other threads that join it, then helps them with the split
+	//points below it until they finish (with reproducibleSplits, it gathers their results in the order the moves
+	//were handed out).
+	void Split(SearchThread &thread, SplitPoint &split);
+
+	//Joins the shallowest open split point of another thread, below split if not NULL. Returns NULL if there is none.
+	SplitPoint *joinSplitPoint(SearchThread &thread, const SplitPoint *below);
+
+	//Searches moves of split until none are left or the search unwinds.
+	void SearchSplitPoint(SearchThread &thread, SplitPoint &split);
+
+	//Body of a YBWC helper: joins split points of the other threads until stopTimer is raised.
+	void IdleLoop(SearchThread &thread);
+
+	//Search of a node one ply above the leaves, with the quiet children evaluated in batches.
+	double SearchFrontier(SearchThread &thread, GameState &pState, int ply, double alpha, double beta, Move &bestMove);
+
+	//Search of the forced capture sequences below a leaf of Negamax.
+	//Positions where the side to move has no jump are quiet and get their static value
+	//(a side that must jump can't stand pat, captures are compulsory).
+	double Quiescence(SearchThread &thread, GameState &pState, int ply, double alpha, double beta);
+
+	//Body of a helper thread: waits for play() to start a search, and runs HelperSearch.
+	void HelperLoop(SearchThread &thread);
+
+	//Iterative deepening of a helper, until stopTimer is raised. Odd helpers search one ply deeper
+	//than the iteration count, and every helper starts with the root moves in a different order.
+	void HelperSearch(SearchThread &thread);
+
+	//Starts and stops the helpers.
+	std::mutex helperMutex;
+	std::condition_variable helperWakeUp; //Signals a new search, or helpersQuit
+	std::condition_variable helperDone; //Signals helpersSearching dropped to 0
+	unsigned helperSearchId = 0; //Incremented by play() for every search the helpers join
+	int helpersSearching = 0; //Helpers that haven't finished the current search
+	bool helpersQuit = false; //Set to end the helper threads
+	std::atomic<int> idleHelpers{0}; //YBWC helpers looking for a split point to join
 };
 
 /*namespace checkers*/ }
@@ -0,0 +1,237 @@
+#include "pnsolver.hpp"
+#include <algorithm>
+
+namespace checkers
+{
+
+ProofNumberSolver::ProofNumberSolver(std::size_t pEntries, int pMaxPly)
+    :   mMask(0)
+    ,   mMaxPly(pMaxPly)
+    ,   mMoves(new Move[pMaxPly * GameState::cMaxMoves])
+    ,   mChildKeys(new uint64_t[pMaxPly * GameState::cMaxMoves])
+    ,   mAttacker(CELL_RED)
+    ,   mDatabase(NULL)
+    ,   mStop(NULL)
+    ,   mAborted(false)
+    ,   mNodes(0)
+{
+    std::size_t lEntries = 2;
+    while (lEntries * 2 <= pEntries)
+        lEntries *= 2;
+
+    mEntries.reset(new Entry[lEntries]);
+    mMask = lEntries - 1;
+    clear();
+}
+
+void ProofNumberSolver::clear()
+{
+    // An empty entry has key 0, which only matches key 0
+    for (uint64_t i = 0; i <= mMask; ++i)
+    {
+        mEntries[i].mKey = 0;
+        mEntries[i].mPhi = 1;
+        mEntries[i].mDelta = 1;
+        mEntries[i].mWork = 0;
+        mEntries[i].mHorizon = cNoHorizon;
+        mEntries[i].mBest = 0;
+    }
+}
+
+ProofNumberSolver::Result ProofNumberSolver::solve(const GameState &pState, uint8_t pAttacker, const Deadline &pDue,
+                                                   const StopTimer &pStop, const EndgameDatabase &pDatabase, Move &pMove)
+{
+    mAttacker = pAttacker;
+    mDatabase = &pDatabase;
+    mStop = &pStop;
+    mCheck = DeadlineCheck(pDue, 256);
+    mAborted = false;
+    mNodes = 0;
+
+    GameState lState = pState;
+    search(lState, 0, cInfinity, cInfinity);
+
+    Entry lEntry;
+    if (mAborted || !probe(key(pState), mMaxPly, lEntry))
+        return RESULT_UNKNOWN;
+
+    // The numbers are for the player to move, whose goal is not to lose if they are not the attacker
+    bool lAttackerToMove = (pState.getNextPlayer() == mAttacker);
+    if (lEntry.mPhi != 0 && lEntry.mDelta != 0)
+        return RESULT_UNKNOWN;
+    if ((lEntry.mPhi == 0) != lAttackerToMove)
+        return RESULT_DISPROVEN;
+
+    if (lAttackerToMove)
+    {
+        Move *lMoves = &mMoves[0];
+        int lNumMoves = pState.findPossibleMoves(lMoves);
+        if (lEntry.mBest < lNumMoves && !lMoves[lEntry.mBest].isEOG())
+            pMove = lMoves[lEntry.mBest];
+    }
+    return RESULT_PROVEN;
+}
+
+uint64_t ProofNumberSolver::key(const GameState &pState) const
+{
+    uint64_t lKey = pState.getHash() ^ ((uint64_t)(pState.getMovesUntilDraw() + 1) * 0x9E3779B97F4A7C15ULL);
+    return (mAttacker == CELL_RED) ? lKey : ~lKey;
+}
+
+bool ProofNumberSolver::probe(uint64_t pKey, int pPliesLeft, Entry &pEntry) const
+{
+    // A line cut closer to the position than it would be now may hide a win of the attacker
+    const Entry *lBucket = &mEntries[pKey & mMask & ~(uint64_t)1];
+    for (int i = 0; i < 2; ++i)
+    {
+        if (lBucket[i].mKey == pKey)
+        {
+            if (lBucket[i].mHorizon != cNoHorizon && lBucket[i].mHorizon < pPliesLeft)
+                return false;
+            pEntry = lBucket[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+void ProofNumberSolver::store(uint64_t pKey, uint32_t pPhi, uint32_t pDelta, uint32_t pWork, int pHorizon, int pBest)
+{
+    // Replace the same position, otherwise the entry that cost less to find (solved entries are kept longest)
+    Entry *lBucket = &mEntries[pKey & mMask & ~(uint64_t)1];
+    Entry *lSlot = &lBucket[0];
+    if (lBucket[1].mKey == pKey)
+        lSlot = &lBucket[1];
+    else if (lBucket[0].mKey != pKey)
+    {
+        bool lSolved[2];
+        for (int i = 0; i < 2; ++i)
+            lSolved[i] = (lBucket[i].mKey != 0) && (lBucket[i].mPhi == 0 || lBucket[i].mDelta == 0);
+        if (lSolved[0] != lSolved[1] ? lSolved[0] : lBucket[1].mWork < lBucket[0].mWork)
+            lSlot = &lBucket[1];
+    }
+
+    lSlot->mKey = pKey;
+    lSlot->mPhi = pPhi;
+    lSlot->mDelta = pDelta;
+    lSlot->mWork = pWork;
+    lSlot->mHorizon = pHorizon;
+    lSlot->mBest = pBest;
+}
+
+void ProofNumberSolver::settle(bool pReached, uint32_t &pPhi, uint32_t &pDelta)
+{
+    pPhi = pReached ? 0 : cInfinity;
+    pDelta = pReached ? cInfinity : 0;
+}
+
+/*
+ * The numbers of a position follow from those of the positions after its
+ * moves, whose player to move is the opponent: the player to move reaches
+ * their goal if the opponent fails after one of the moves (phi is the least
+ * delta of the moves), and fails if the opponent reaches theirs after all
+ * of them (delta is the sum of their phi). The move with the least delta is
+ * searched until the numbers of the position reach the limits, or until
+ * another move becomes cheaper, which the limits given to it account for.
+ */
+void ProofNumberSolver::search(GameState &pState, int pPly, uint32_t pMaxPhi, uint32_t pMaxDelta)
+{
+    ++mNodes;
+    if (mCheck.expired() || mStop->stopped())
+        mAborted = true;
+    if (mAborted)
+        return;
+
+    uint64_t lKey = key(pState);
+    bool lAttackerToMove = (pState.getNextPlayer() == mAttacker);
+    uint32_t lPhi, lDelta;
+
+    // Positions in the database are settled (except the root, which needs a move)
+    EndgameDatabase::Result lKnown = pPly ? mDatabase->probe(pState) : EndgameDatabase::RESULT_UNKNOWN;
+    if (lKnown != EndgameDatabase::RESULT_UNKNOWN)
+    {
+        settle(lKnown == EndgameDatabase::RESULT_WIN || (lKnown == EndgameDatabase::RESULT_DRAW && !lAttackerToMove),
+               lPhi, lDelta);
+        store(lKey, lPhi, lDelta, 1, cNoHorizon, 0);
+        return;
+    }
+
+    // Lines too deep count as draws, with no plies left to find a win
+    if (pPly >= mMaxPly)
+    {
+        settle(!lAttackerToMove, lPhi, lDelta);
+        store(lKey, lPhi, lDelta, 1, 0, 0);
+        return;
+    }
+
+    Move *lMoves = &mMoves[pPly * GameState::cMaxMoves];
+    int lNumMoves = pState.findPossibleMoves(lMoves);
+    if (lNumMoves == 1 && lMoves[0].isEOG())
+    {
+        uint8_t lMover = pState.getNextPlayer();
+        bool lWon = (lMoves[0].isRedWin() && lMover == CELL_RED) || (lMoves[0].isWhiteWin() && lMover == CELL_WHITE);
+        settle(lWon || (lMoves[0].isDraw() && !lAttackerToMove), lPhi, lDelta);
+        store(lKey, lPhi, lDelta, 1, cNoHorizon, 0);
+        return;
+    }
+
+    uint64_t *lChildKeys = &mChildKeys[pPly * GameState::cMaxMoves];
+    for (int i = 0; i < lNumMoves; ++i)
+    {
+        GameState::Undo lUndo;
+        pState.makeMove(lMoves[i], lUndo);
+        lChildKeys[i] = key(pState);
+        pState.unmakeMove(lMoves[i], lUndo);
+    }
+
+    uint64_t lNodesBefore = mNodes;
+    while (true)
+    {
+        // Moves not searched yet count as 1 both ways
+        int lBest = 0;
+        uint32_t lBestPhi = 1;
+        uint32_t lSecondDelta = cInfinity;
+        bool lCut = false;
+        lPhi = cInfinity;
+        lDelta = 0;
+        for (int i = 0; i < lNumMoves; ++i)
+        {
+            Entry lChild;
+            uint32_t lChildPhi = 1, lChildDelta = 1;
+            if (probe(lChildKeys[i], mMaxPly - pPly - 1, lChild))
+            {
+                lChildPhi = lChild.mPhi;
+                lChildDelta = lChild.mDelta;
+                lCut = lCut || lChild.mHorizon != cNoHorizon;
+            }
+            lDelta = (lDelta + lChildPhi < cInfinity) ? lDelta + lChildPhi : cInfinity;
+            if (lChildDelta < lPhi)
+            {
+                lSecondDelta = lPhi;
+                lPhi = lChildDelta;
+                lBest = i;
+                lBestPhi = lChildPhi;
+            }
+            else if (lChildDelta < lSecondDelta)
+                lSecondDelta = lChildDelta;
+        }
+
+        if (lPhi >= pMaxPhi || lDelta >= pMaxDelta)
+        {
+            // A win of the attacker never depends on a cut line (they count as draws)
+            bool lAttackerWins = lAttackerToMove ? lPhi == 0 : lDelta == 0;
+            int lHorizon = (lCut && !lAttackerWins) ? mMaxPly - pPly : cNoHorizon;
+            store(lKey, lPhi, lDelta, (uint32_t)std::min<uint64_t>(mNodes - lNodesBefore + 1, cInfinity), lHorizon, lBest);
+            return;
+        }
+
+        GameState::Undo lUndo;
+        pState.makeMove(lMoves[lBest], lUndo);
+        search(pState, pPly + 1, pMaxDelta - lDelta + lBestPhi, std::min(pMaxPhi, lSecondDelta + 1));
+        pState.unmakeMove(lMoves[lBest], lUndo);
+        if (mAborted)
+            return;
+    }
+}
+
+/*namespace checkers*/ }
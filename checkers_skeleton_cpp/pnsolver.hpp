@@ -0,0 +1,131 @@
+#ifndef _CHECKERS_PNSOLVER_HPP_
+#define _CHECKERS_PNSOLVER_HPP_
+
+#include "deadline.hpp"
+#include "egdb.hpp"
+#include "gamestate.hpp"
+#include "move.hpp"
+#include "stoptimer.hpp"
+#include <stdint.h>
+#include <cstddef>
+#include <memory>
+
+namespace checkers
+{
+
+/**
+ * A depth-first proof-number (df-pn) solver
+ *
+ * It tries to prove that one player, the attacker, wins a position: the
+ * game ends with the attacker winning whatever the other player does. A
+ * draw counts as a failure of the attacker. Unlike the alpha-beta search it
+ * looks at no evaluation, and grows the tree where a proof (or disproof)
+ * looks cheapest, which finds long forced lines such as capture chains and
+ * races to promotion quickly.
+ *
+ * The proof and disproof numbers are kept in a hash table that is not
+ * cleared between calls, so positions proven (or partly searched) for an
+ * earlier move are not searched again. The key covers the moves until
+ * draw, which makes the game tree acyclic: a move either lowers the counter
+ * or captures a piece.
+ *
+ * Lines deeper than the ply limit (cMaxPly by default) are counted as draws,
+ * so a proof never depends on them, but a disproof only means no win was
+ * found within the limit. Numbers that depend on such a line are stored with
+ * the plies that were left below the position, and only used again where no
+ * more plies are left (a position reached closer to the root, or in a later
+ * call, is searched again).
+ */
+class ProofNumberSolver
+{
+public:
+    static const std::size_t cDefaultEntries = 1 << 19;
+    static const int cMaxPly = 256;             ///< deepest line searched by default
+
+    ///outcome of solve()
+    enum Result
+    {
+        RESULT_UNKNOWN,         ///< neither proven nor disproven in the time given
+        RESULT_PROVEN,          ///< the attacker wins
+        RESULT_DISPROVEN        ///< the attacker does not win (or not within the ply limit)
+    };
+
+    ///creates a solver whose table has room for \p pEntries positions (rounded down to a power of two),
+    ///and which searches lines up to \p pMaxPly plies deep
+    explicit ProofNumberSolver(std::size_t pEntries = cDefaultEntries, int pMaxPly = cMaxPly);
+
+    ///removes all the entries of the table
+    void clear();
+
+    /**
+     * Tries to prove that \p pAttacker wins \p pState
+     *
+     * \param pState the position, which must not be finished
+     * \param pAttacker the player to prove the win of (CELL_RED or CELL_WHITE)
+     * \param pDue the search gives up (returning RESULT_UNKNOWN) at this time
+     * \param pStop the search gives up when this is stopped as well
+     * \param pDatabase positions found in it are not searched
+     * \param pMove receives a winning move if proven and the attacker is to move
+     */
+    Result solve(const GameState &pState, uint8_t pAttacker, const Deadline &pDue, const StopTimer &pStop,
+                 const EndgameDatabase &pDatabase, Move &pMove);
+
+    ///returns the number of positions searched by the last call to solve()
+    uint64_t getNodes() const   {    return mNodes;    }
+
+private:
+    static const uint32_t cInfinity = 1u << 30;
+    static const uint16_t cNoHorizon = 0xFFFF;  ///< numbers that don't depend on the ply limit
+
+    ///proof and disproof numbers of a position, for the player to move
+    struct Entry
+    {
+        uint64_t mKey;
+        uint32_t mPhi;      ///< how hard it is to prove that the player to move reaches their goal (0: proven)
+        uint32_t mDelta;    ///< how hard it is to prove that they don't (0: proven)
+        uint32_t mWork;     ///< positions searched to get these numbers
+        uint16_t mHorizon;  ///< plies left below the position if a line was cut at the ply limit, else cNoHorizon
+        uint8_t mBest;      ///< index of the best move in the list of findPossibleMoves()
+    };
+
+    ///returns the key of \p pState, which covers the moves until draw and the attacker
+    uint64_t key(const GameState &pState) const;
+
+    ///finds the numbers of the position with key \p pKey, with \p pPliesLeft plies left below it,
+    ///returns false if it isn't in the table or its numbers were found with fewer plies left
+    bool probe(uint64_t pKey, int pPliesLeft, Entry &pEntry) const;
+
+    ///stores the numbers of the position with key \p pKey
+    void store(uint64_t pKey, uint32_t pPhi, uint32_t pDelta, uint32_t pWork, int pHorizon, int pBest);
+
+    ///sets the numbers of a finished line: \p pReached tells if the player to move reached their goal
+    static void settle(bool pReached, uint32_t &pPhi, uint32_t &pDelta);
+
+    /**
+     * Searches \p pState until its phi reaches \p pMaxPhi or its delta reaches \p pMaxDelta
+     *
+     * The numbers found are stored in the table (unless the search gave up).
+     */
+    void search(GameState &pState, int pPly, uint32_t pMaxPhi, uint32_t pMaxDelta);
+
+    std::unique_ptr<Entry[]> mEntries;
+    uint64_t mMask;
+    int mMaxPly;
+
+    ///move lists of the positions being searched, cMaxMoves for each ply
+    std::unique_ptr<Move[]> mMoves;
+    ///keys of the positions after those moves
+    std::unique_ptr<uint64_t[]> mChildKeys;
+
+    //State of the current call to solve()
+    uint8_t mAttacker;
+    const EndgameDatabase *mDatabase;
+    const StopTimer *mStop;
+    DeadlineCheck mCheck;
+    bool mAborted;
+    uint64_t mNodes;
+};
+
+/*namespace checkers*/ }
+
+#endif
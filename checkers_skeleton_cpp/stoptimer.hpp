@@ -0,0 +1,111 @@
+#ifndef _CHECKERS_STOPTIMER_HPP_
+#define _CHECKERS_STOPTIMER_HPP_
+
+#include "deadline.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace checkers
+{
+
+///an atomic stop flag, raised by a timer thread when a deadline is reached
+
+///Searches (on any number of threads) poll stopped() at every node, which
+///is a single relaxed atomic load, and unwind as soon as it returns true.
+///The flag is raised even if the searching threads never read the clock.
+///The timer thread is started by the first call to start() and then waits
+///for the next deadline, so later searches don't create threads.
+class StopTimer
+{
+public:
+    StopTimer()
+        :   mStop(false)
+        ,   mArmed(false)
+        ,   mQuit(false)
+    {
+    }
+
+    ~StopTimer()
+    {
+        if (!mThread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lLock(mMutex);
+            mArmed = false;
+            mQuit = true;
+        }
+        mWakeUp.notify_all();
+        mThread.join();
+    }
+
+    ///clears the flag and has the timer thread raise it at \p pWhen
+    void start(const Deadline &pWhen)
+    {
+        {
+            std::lock_guard<std::mutex> lLock(mMutex);
+            mStop.store(false, std::memory_order_relaxed);
+            mWhen = pWhen;
+            mArmed = true;
+        }
+        if (!mThread.joinable())
+            mThread = std::thread(&StopTimer::run, this);
+        mWakeUp.notify_all();
+    }
+
+    ///disarms the timer; the flag keeps its current value and won't be raised by the timer afterwards
+    void cancel()
+    {
+        {
+            std::lock_guard<std::mutex> lLock(mMutex);
+            mArmed = false;
+        }
+        mWakeUp.notify_all();
+    }
+
+    ///raises the flag right away
+    void stop()                 {    mStop.store(true, std::memory_order_relaxed);    }
+
+    ///clears the flag (the timer, if armed, can still raise it)
+    void reset()                {    mStop.store(false, std::memory_order_relaxed);    }
+
+    ///returns true once the flag has been raised
+    bool stopped() const        {    return mStop.load(std::memory_order_relaxed);    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lLock(mMutex);
+        while (!mQuit)
+        {
+            if (!mArmed)
+            {
+                mWakeUp.wait(lLock);
+                continue;
+            }
+            double lLeft = mWhen - Deadline::now();
+            if (lLeft <= 0.0)
+            {
+                // Checked and raised under the lock, so cancel() can't be overtaken
+                stop();
+                mArmed = false;
+                continue;
+            }
+            mWakeUp.wait_for(lLock, std::chrono::duration<double>(lLeft));
+        }
+    }
+
+    std::atomic<bool> mStop;
+    bool mArmed;
+    bool mQuit;
+    Deadline mWhen;
+    std::mutex mMutex;
+    std::condition_variable mWakeUp;
+    std::thread mThread;
+};
+
+/*namespace checkers*/ }
+
+#endif
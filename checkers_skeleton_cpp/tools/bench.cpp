@@ -0,0 +1,334 @@
+#include "../player.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// Every allocation made with new goes through here, so the benchmark can
+// tell whether searching touches the heap
+static std::atomic<uint64_t> sAllocations(0);
+
+void *operator new(std::size_t pSize)
+{
+    ++sAllocations;
+    void *lMemory = malloc(pSize ? pSize : 1);
+    if (!lMemory)
+        throw std::bad_alloc();
+    return lMemory;
+}
+
+void operator delete(void *pMemory) noexcept
+{
+    free(pMemory);
+}
+
+void operator delete(void *pMemory, std::size_t) noexcept
+{
+    free(pMemory);
+}
+
+/**
+ * Compares the AVX2 and plain code terms of the batched evaluation
+ *
+ * Evaluates the positions two plies after each of \p pPositions (as the
+ * frontier nodes of the search would) both ways, and returns the number of
+ * positions whose terms differ. Does nothing without AVX2.
+ */
+static uint64_t checkEvalBatch(const std::vector<checkers::GameState> &pPositions)
+{
+    if (!checkers::EvalBatch::usesAVX2())
+    {
+        std::cout << "no AVX2, batched evaluation not compared" << std::endl;
+        return 0;
+    }
+
+    checkers::EvalBatch batch;
+    checkers::Move moves[checkers::GameState::cMaxMoves];
+    checkers::Move replies[checkers::GameState::cMaxMoves];
+    uint64_t compared = 0;
+    uint64_t differences = 0;
+    auto compare = [&]()
+    {
+        checkers::EvalBatch scalar = batch;
+        scalar.evaluateScalar();
+        batch.evaluateAVX2();
+        for (int i = 0; i < batch.size(); ++i)
+        {
+            ++compared;
+            if (batch.getMen(i) != scalar.getMen(i) || batch.getKingCount(i) != scalar.getKingCount(i) ||
+                batch.getRedMoves(i) != scalar.getRedMoves(i) || batch.getWhiteMoves(i) != scalar.getWhiteMoves(i))
+                ++differences;
+        }
+        batch.clear();
+    };
+
+    for (size_t p = 0; p < pPositions.size(); ++p)
+    {
+        checkers::GameState state = pPositions[p];
+        int num_moves = state.findPossibleMoves(moves);
+        for (int m = 0; m < num_moves && !moves[m].isEOG(); ++m)
+        {
+            checkers::GameState::Undo undo;
+            state.makeMove(moves[m], undo);
+            int num_replies = state.findPossibleMoves(replies);
+            for (int r = 0; r < num_replies && !replies[r].isEOG(); ++r)
+            {
+                checkers::GameState::Undo reply_undo;
+                state.makeMove(replies[r], reply_undo);
+                batch.add(state);
+                state.unmakeMove(replies[r], reply_undo);
+                // Partly filled batches are compared too, for the lanes past the size
+                if (batch.full() || r == num_replies - 1)
+                    compare();
+            }
+            state.unmakeMove(moves[m], undo);
+        }
+    }
+
+    std::cout << "batched evaluation: " << compared << " positions compared, " << differences
+              << " differ between AVX2 and plain code" << std::endl;
+    return differences;
+}
+
+/**
+ * Searches each of \p pPositions to \p pDepth with 1 to \p pMaxThreads threads
+ *
+ * Prints, for each number of threads, the time the search took to reach
+ * the depth (with a cleared transposition table for every position), the
+ * nodes searched by all threads and the speed-up over one thread.
+ */
+static void reportScaling(const std::vector<checkers::GameState> &pPositions, int pDepth, int pMaxThreads,
+                          int pSplitPoints)
+{
+    double single_time = 0.0;
+    uint64_t single_nodes = 0;
+    for (int t = 1; t <= pMaxThreads; ++t)
+    {
+        checkers::Player player;
+        player.useSplitPoints = pSplitPoints > 0;
+        player.reproducibleSplits = pSplitPoints == 2;
+        player.setThreads(t);
+        player.maxDepth = pDepth;
+
+        double search_time = 0.0;
+        uint64_t nodes = 0;
+        for (size_t p = 0; p < pPositions.size(); ++p)
+        {
+            player.transpositionTable.clear();
+            checkers::Deadline start = checkers::Deadline::now();
+            player.play(pPositions[p], start + 3600.0);
+            search_time += checkers::Deadline::now() - start;
+            nodes += player.nodes;
+        }
+        if (t == 1)
+        {
+            single_time = search_time;
+            single_nodes = nodes;
+        }
+
+        std::cout << "threads " << t << " time to depth " << pDepth << " " << search_time << " s nodes " << nodes;
+        if (search_time > 0)
+            std::cout << " nps " << (uint64_t)(nodes / search_time) << " speed-up " << single_time / search_time
+                      << " nodes/1 thread " << (double)nodes / single_nodes;
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * Searches each of \p pPositions to \p pDepth with reproducible split points (YBWC), once with one thread and
+ * twice with \p pThreads threads
+ *
+ * Each time, a new player searches the positions one after the other. The
+ * solver is off, since it stops on time. Returns the number of positions
+ * where a search didn't visit the same number of nodes as the one with one
+ * thread or didn't choose the same move.
+ */
+static int checkReproducible(const std::vector<checkers::GameState> &pPositions, int pDepth, int pThreads)
+{
+    std::vector<uint64_t> nodes[3];
+    std::vector<std::string> moves[3];
+    for (int r = 0; r < 3; ++r)
+    {
+        checkers::Player player;
+        player.useSplitPoints = true;
+        player.reproducibleSplits = true;
+        player.useSolver = false;
+        player.setThreads(r == 0 ? 1 : pThreads);
+        player.maxDepth = pDepth;
+        for (size_t p = 0; p < pPositions.size(); ++p)
+        {
+            checkers::GameState next = player.play(pPositions[p], checkers::Deadline::now() + 3600.0);
+            nodes[r].push_back(player.nodes);
+            moves[r].push_back(next.getMove().toMessage());
+        }
+    }
+
+    int differences = 0;
+    for (size_t p = 0; p < pPositions.size(); ++p)
+        for (int r = 1; r < 3; ++r)
+            if (nodes[r][p] != nodes[0][p] || moves[r][p] != moves[0][p])
+                ++differences;
+    std::cout << "ybwc: " << pPositions.size() << " positions searched to depth " << pDepth << " with 1 thread and twice with "
+              << pThreads << " threads, " << differences << " searches differ" << std::endl;
+    return differences;
+}
+
+/**
+ * Checks that the proof-number solver doesn't reuse results of lines cut at its ply limit
+ *
+ * White wins the position after 0_7_3 within 8 plies. Searched from the
+ * position before that move with a limit of 8 plies, it is cut one ply
+ * earlier, and the win is not found there. A second call from the position
+ * after the move, with the same table, must still prove it. Returns 1 if it
+ * doesn't.
+ */
+static int checkSolverCut()
+{
+    checkers::GameState before(".R.....wW......W........W....... -1 w 40");
+    checkers::GameState after(".R.W....W......W........W....... 0_7_3 r 39");
+    checkers::EndgameDatabase no_database;
+    checkers::StopTimer stop;
+    checkers::Move move;
+    checkers::ProofNumberSolver solver(1 << 16, 8);
+    solver.solve(before, checkers::CELL_WHITE, checkers::Deadline::now() + 10.0, stop, no_database, move);
+    checkers::ProofNumberSolver::Result result =
+        solver.solve(after, checkers::CELL_WHITE, checkers::Deadline::now() + 10.0, stop, no_database, move);
+
+    bool proven = (result == checkers::ProofNumberSolver::RESULT_PROVEN);
+    std::cout << "solver: win at the ply limit " << (proven ? "proven" : "not proven") << " after a search that cut it"
+              << std::endl;
+    return proven ? 0 : 1;
+}
+
+/**
+ * Lets a Player play against itself and reports how fast it searched
+ *
+ * Each move reports the time it took against the time it was given, and so
+ * does the summary for the moves after the first, on average.
+ *
+ * The first move is a warm-up: anything the player sets up once (such as
+ * the timer and helper threads) is allocated then. The moves after it are
+ * expected to make no heap allocations at all, and the exit status is 1 if
+ * they do.
+ *
+ * The batched evaluation is then checked on the positions of the game (see
+ * checkEvalBatch()), and the exit status is 1 as well if AVX2 and plain code
+ * disagree.
+ *
+ * The exit status is 1 as well if the proof-number solver reuses a line cut
+ * at its ply limit as a result (see checkSolverCut()).
+ *
+ * With ybwc 2, the positions are searched to the scaling depth (8 without
+ * one) with one thread and twice with the given number, and the exit status
+ * is 1 if the node counts differ (see checkReproducible()).
+ *
+ * With a scaling depth, the positions of the game are then searched again
+ * to that depth with 1 to the given number of threads (see reportScaling()).
+ * With ybwc 1 the helpers join split points instead of searching on their own,
+ * with ybwc 2 reproducible ones (see Player::reproducibleSplits).
+ */
+int main(int argc, char **argv)
+{
+    // Parse parameters
+    int num_moves = 16;
+    double seconds = 0.2;
+    int num_threads = 1;
+    int scaling_depth = 0;
+    int split_points = 0;
+    std::string file = "startState.txt";
+    std::string message;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string param(argv[i]);
+        bool has_value = (i + 1 < argc);
+        if ((param == "moves" || param == "n") && has_value)
+            num_moves = atoi(argv[++i]);
+        else if ((param == "seconds" || param == "s") && has_value)
+            seconds = atof(argv[++i]);
+        else if ((param == "threads" || param == "t") && has_value)
+            num_threads = atoi(argv[++i]);
+        else if (param == "scaling" && has_value)
+            scaling_depth = atoi(argv[++i]);
+        else if (param == "ybwc" && has_value)
+            split_points = atoi(argv[++i]);
+        else if ((param == "file" || param == "f") && has_value)
+            file = argv[++i];
+        else if ((param == "message" || param == "m") && has_value)
+            message = argv[++i];
+        else
+        {
+            std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [moves N] [seconds S] [threads T] [scaling DEPTH] [ybwc B] [file FILE | message MESSAGE]" << std::endl;
+            return -1;
+        }
+    }
+    if (num_moves < 2 || seconds <= 0.0 || num_threads < 1)
+    {
+        std::cerr << "Play at least 2 moves, with a positive time per move and at least one thread" << std::endl;
+        return -1;
+    }
+
+    // Read the position, from the command line or from the state file
+    if (message.empty())
+    {
+        std::ifstream input(file.c_str());
+        if (!std::getline(input, message))
+        {
+            std::cerr << "Could not read a state from '" << file << "'" << std::endl;
+            return -1;
+        }
+    }
+    checkers::GameState state(message);
+
+    checkers::Player player;
+    player.useSplitPoints = split_points > 0;
+    player.reproducibleSplits = split_points == 2;
+    player.setThreads(num_threads);
+    std::vector<checkers::GameState> positions;
+    positions.reserve(num_moves);
+    uint64_t nodes = 0;
+    uint64_t allocations = 0;
+    double search_time = 0.0;
+    int searched_moves = 0;
+    for (int m = 0; m < num_moves && !state.isEOG(); ++m)
+    {
+        positions.push_back(state);
+        uint64_t allocations_before = sAllocations;
+        checkers::Deadline start = checkers::Deadline::now();
+        state = player.play(state, start + seconds);
+        double elapsed = checkers::Deadline::now() - start;
+        uint64_t move_allocations = sAllocations - allocations_before;
+
+        std::cout << "move " << m + 1 << " " << state.getMove().toMessage() << " depth " << player.completedDepth
+                  << " nodes " << player.nodes << " time " << elapsed << " s of " << seconds << " s allocations "
+                  << move_allocations << (m == 0 ? " (warm-up)" : "") << std::endl;
+        if (m == 0)
+            continue;
+        nodes += player.nodes;
+        search_time += elapsed;
+        allocations += move_allocations;
+        ++searched_moves;
+    }
+
+    std::cout << "nodes " << nodes << " time " << search_time << " s";
+    if (search_time > 0)
+        std::cout << " nps " << (uint64_t)(nodes / search_time);
+    std::cout << " allocations after warm-up " << allocations << std::endl;
+    if (searched_moves > 0)
+        std::cout << "time used per move " << search_time / searched_moves << " s of " << seconds << " s ("
+                  << 100.0 * search_time / (searched_moves * seconds) << "% of the budget)" << std::endl;
+
+    uint64_t differences = checkEvalBatch(positions);
+    differences += checkSolverCut();
+    if (split_points == 2)
+        differences += checkReproducible(positions, scaling_depth > 0 ? scaling_depth : 8, num_threads);
+
+    if (scaling_depth > 0)
+        reportScaling(positions, scaling_depth, num_threads, split_points);
+    return (allocations || differences) ? 1 : 0;
+}
@@ -0,0 +1,275 @@
+#include "../egdb.hpp"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using checkers::EndgameDatabase;
+using checkers::GameState;
+
+typedef EndgameDatabase::Material Material;
+
+static const int cSide = EndgameDatabase::cMaxPieces + 1;
+
+///returns the position of the values of \p pMaterial in the list of slices
+static int sliceKey(const Material &pMaterial)
+{
+    return ((pMaterial.mRedMen * cSide + pMaterial.mRedKings) * cSide + pMaterial.mWhiteMen) * cSide +
+           pMaterial.mWhiteKings;
+}
+
+///returns the slice with the colors swapped
+static Material swapped(const Material &pMaterial)
+{
+    Material lSwapped = {pMaterial.mWhiteMen, pMaterial.mWhiteKings, pMaterial.mRedMen, pMaterial.mRedKings};
+    return lSwapped;
+}
+
+/**
+ * The values of the slices generated so far, kept in memory (a multiple
+ * jump can lead to any slice with fewer pieces)
+ *
+ * The slices being generated are read and written by several threads at
+ * once, hence the atomics; a value only changes once per slice, from
+ * VALUE_DRAW (undecided) to its final value.
+ */
+class Tables
+{
+public:
+    Tables()
+        :   mValues(cSide * cSide * cSide * cSide)
+    {
+    }
+
+    ///allocates the values of a slice, all undecided
+    std::atomic<uint8_t> *create(const Material &pMaterial)
+    {
+        uint64_t lPositions = EndgameDatabase::positions(pMaterial);
+        std::unique_ptr<std::atomic<uint8_t>[]> &lValues = mValues[sliceKey(pMaterial)];
+        lValues.reset(new std::atomic<uint8_t>[lPositions]);
+        for (uint64_t i = 0; i < lPositions; ++i)
+            lValues[i].store(EndgameDatabase::VALUE_DRAW, std::memory_order_relaxed);
+        return lValues.get();
+    }
+
+    /**
+     * Returns the result of \p pState for the side to move, looked up in the slices
+     *
+     * The slice of the position must have been created.
+     */
+    EndgameDatabase::Result result(const GameState &pState) const
+    {
+        if (pState.getMovesUntilDraw() <= 0)
+            return EndgameDatabase::RESULT_DRAW;
+
+        uint32_t lRed = pState.getRedPieces();
+        uint32_t lWhite = pState.getWhitePieces();
+        uint32_t lKings = pState.getKings();
+        if (pState.getNextPlayer() == checkers::CELL_WHITE)
+        {
+            uint32_t lRotatedRed = GameState::reverseMask(lWhite);
+            lWhite = GameState::reverseMask(lRed);
+            lRed = lRotatedRed;
+            lKings = GameState::reverseMask(lKings);
+        }
+        // A player without pieces can't move, and has lost
+        if (!lRed)
+            return EndgameDatabase::RESULT_LOSS;
+
+        const std::atomic<uint8_t> *lValues = mValues[sliceKey(EndgameDatabase::material(lRed, lWhite, lKings))].get();
+        assert(lValues);
+        uint8_t lValue = lValues[EndgameDatabase::index(lRed, lWhite, lKings)].load(std::memory_order_relaxed);
+        return EndgameDatabase::decode(lValue, pState.getMovesUntilDraw());
+    }
+
+private:
+    std::vector<std::unique_ptr<std::atomic<uint8_t>[]>> mValues;
+};
+
+/**
+ * Decides the positions of \p pSlices (one slice, or a slice and its swapped one) won or lost
+ * with exactly \p pMovesLeft moves left until draw, and returns how many there were
+ *
+ * A position is won if a move leads to a lost position, and lost if every
+ * move leads to a won one. Normal moves leave one move less until draw, so
+ * they lead to positions decided by the passes before; jumps lead to slices
+ * with fewer pieces, with the moves until draw starting over. Crowning a man
+ * leads to a slice with fewer men, which was generated before.
+ */
+static uint64_t decidePass(const Tables &pTables, const Material pSlices[], std::atomic<uint8_t> *pValues[],
+                           int pNumSlices, int pMovesLeft, int pThreads)
+{
+    const uint64_t cChunk = 4096;
+    uint64_t lPositions = EndgameDatabase::positions(pSlices[0]);
+    std::atomic<uint64_t> lNextChunk(0);
+    std::atomic<uint64_t> lDecided(0);
+
+    auto worker = [&]()
+    {
+        checkers::Move lMoves[GameState::cMaxMoves];
+        uint64_t lWorkerDecided = 0;
+        for (uint64_t lStart = lNextChunk++ * cChunk; lStart < lPositions; lStart = lNextChunk++ * cChunk)
+        {
+            uint64_t lEnd = std::min(lStart + cChunk, lPositions);
+            for (int s = 0; s < pNumSlices; ++s)
+            {
+                for (uint64_t i = lStart; i < lEnd; ++i)
+                {
+                    if (pValues[s][i].load(std::memory_order_relaxed) != EndgameDatabase::VALUE_DRAW)
+                        continue;
+
+                    uint32_t lRed, lWhite, lKings;
+                    EndgameDatabase::position(pSlices[s], i, lRed, lWhite, lKings);
+                    if ((lRed & ~lKings & GameState::cRedKingRow) || (lWhite & ~lKings & GameState::cWhiteKingRow))
+                    {
+                        pValues[s][i].store(EndgameDatabase::VALUE_INVALID, std::memory_order_relaxed);
+                        continue;
+                    }
+
+                    GameState lState(lRed, lWhite, lKings, checkers::CELL_RED, pMovesLeft);
+                    int lNumMoves = lState.findPossibleMoves(lMoves);
+                    bool lWon = false;
+                    bool lLost = true;
+                    for (int m = 0; m < lNumMoves && !lWon; ++m)
+                    {
+                        // Admitting loss is the only move of a player who can't move
+                        if (lMoves[m].isEOG())
+                            break;
+                        GameState::Undo lUndo;
+                        lState.makeMove(lMoves[m], lUndo);
+                        EndgameDatabase::Result lResult = pTables.result(lState);
+                        lState.unmakeMove(lMoves[m], lUndo);
+                        lWon = (lResult == EndgameDatabase::RESULT_LOSS);
+                        lLost = lLost && (lResult == EndgameDatabase::RESULT_WIN);
+                    }
+
+                    if (lWon)
+                        pValues[s][i].store(EndgameDatabase::VALUE_WIN + pMovesLeft, std::memory_order_relaxed);
+                    else if (lLost)
+                        pValues[s][i].store(EndgameDatabase::VALUE_LOSS + pMovesLeft, std::memory_order_relaxed);
+                    else
+                        continue;
+                    ++lWorkerDecided;
+                }
+            }
+        }
+        lDecided += lWorkerDecided;
+    };
+
+    std::vector<std::thread> lPool;
+    for (int t = 1; t < pThreads; ++t)
+        lPool.push_back(std::thread(worker));
+    worker();
+    for (unsigned t = 0; t < lPool.size(); ++t)
+        lPool[t].join();
+    return lDecided;
+}
+
+/**
+ * Generates the databases of all the positions with up to a number of pieces
+ *
+ * Slices are generated by number of pieces, then by number of men, so that
+ * jumps and crownings always lead to slices generated before. A slice and
+ * the one with the colors swapped are generated together, since the normal
+ * moves of either lead to the other. The values of a pair of slices are
+ * decided in passes, one for each number of moves left until draw from 1
+ * up, which is retrograde analysis with the draw counter as the clock: a
+ * pass only decides positions whose result needs exactly that many moves.
+ */
+int main(int argc, char **argv)
+{
+    // Parse parameters
+    int max_pieces = 4;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string directory = ".";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string param(argv[i]);
+        bool has_value = (i + 1 < argc);
+        if ((param == "pieces" || param == "p") && has_value)
+            max_pieces = atoi(argv[++i]);
+        else if ((param == "threads" || param == "t") && has_value)
+            threads = atoi(argv[++i]);
+        else if ((param == "dir" || param == "d") && has_value)
+            directory = argv[++i];
+        else
+        {
+            std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [pieces N] [threads T] [dir DIRECTORY]" << std::endl;
+            return -1;
+        }
+    }
+    if (max_pieces < 2 || max_pieces > EndgameDatabase::cMaxPieces || threads < 1)
+    {
+        std::cerr << "Pieces must be from 2 to " << EndgameDatabase::cMaxPieces << ", threads at least 1" << std::endl;
+        return -1;
+    }
+
+    Tables tables;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int pieces = 2; pieces <= max_pieces; ++pieces)
+    {
+        for (int men = 0; men <= pieces; ++men)
+        {
+            for (int red_men = 0; red_men <= men; ++red_men)
+            for (int red_kings = 0; red_kings <= pieces - men; ++red_kings)
+            {
+                Material material = {red_men, red_kings, men - red_men, pieces - men - red_kings};
+                Material other = swapped(material);
+                if (material.mRedMen + material.mRedKings == 0 || other.mRedMen + other.mRedKings == 0)
+                    continue;
+                // Each pair once, from the side with fewer men (or fewer kings)
+                if (sliceKey(other) < sliceKey(material))
+                    continue;
+
+                Material slices[2] = {material, other};
+                int num_slices = (sliceKey(other) == sliceKey(material)) ? 1 : 2;
+                std::atomic<uint8_t> *values[2];
+                for (int s = 0; s < num_slices; ++s)
+                    values[s] = tables.create(slices[s]);
+
+                // Once a pass decides nothing, the next ones would see the same positions and decide nothing either
+                int passes = 0;
+                for (int moves_left = 1; moves_left <= GameState::cMovesUntilDraw; ++moves_left)
+                {
+                    ++passes;
+                    if (!decidePass(tables, slices, values, num_slices, moves_left, threads))
+                        break;
+                }
+
+                for (int s = 0; s < num_slices; ++s)
+                {
+                    uint64_t positions = EndgameDatabase::positions(slices[s]);
+                    uint64_t counts[3] = {0, 0, 0};
+                    std::vector<uint8_t> plain(positions);
+                    for (uint64_t i = 0; i < positions; ++i)
+                    {
+                        plain[i] = values[s][i].load(std::memory_order_relaxed);
+                        if (plain[i] == EndgameDatabase::VALUE_INVALID)
+                            continue;
+                        counts[plain[i] == EndgameDatabase::VALUE_DRAW ? 0 : plain[i] < EndgameDatabase::VALUE_LOSS ? 1 : 2]++;
+                    }
+
+                    std::string name = EndgameDatabase::fileName(slices[s]);
+                    if (!EndgameDatabase::write(directory + "/" + name, slices[s], &plain[0]))
+                    {
+                        std::cerr << "Could not write '" << directory << "/" << name << "'" << std::endl;
+                        return 1;
+                    }
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    std::cout << name << " positions " << positions << " wins " << counts[1] << " losses " << counts[2]
+                              << " draws " << counts[0] << " passes " << passes << " time " << seconds << " s"
+                              << std::endl;
+                }
+            }
+        }
+    }
+}
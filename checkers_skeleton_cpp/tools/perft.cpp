@@ -0,0 +1,129 @@
+#include "../gamestate.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Counts the leaf nodes of the move tree of \p pState down to \p pDepth plies
+ *
+ * End of game moves (draw, loss) count as nodes, exactly as they are
+ * returned by findPossibleMoves.
+ */
+static uint64_t perft(checkers::GameState &pState, int pDepth)
+{
+    checkers::Move lMoves[checkers::GameState::cMaxMoves];
+    int lNumMoves = pState.findPossibleMoves(lMoves);
+
+    if (pDepth == 1)
+        return lNumMoves;
+
+    uint64_t lNodes = 0;
+    for (int i = 0; i < lNumMoves; ++i)
+    {
+        checkers::GameState::Undo lUndo;
+        pState.makeMove(lMoves[i], lUndo);
+        lNodes += perft(pState, pDepth - 1);
+        pState.unmakeMove(lMoves[i], lUndo);
+    }
+    return lNodes;
+}
+
+int main(int argc, char **argv)
+{
+    // Parse parameters
+    int depth = 6;
+    bool divide = false;
+    int threads = 1;
+    std::string file = "startState.txt";
+    std::string message;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string param(argv[i]);
+        bool has_value = (i + 1 < argc);
+        if (param == "divide" || param == "d")
+            divide = true;
+        else if ((param == "threads" || param == "t") && has_value)
+            threads = atoi(argv[++i]);
+        else if ((param == "file" || param == "f") && has_value)
+            file = argv[++i];
+        else if ((param == "message" || param == "m") && has_value)
+            message = argv[++i];
+        else if (param.find_first_not_of("0123456789") == std::string::npos)
+            depth = atoi(argv[i]);
+        else
+        {
+            std::cerr << "Unknown parameter: '" << argv[i] << "'" << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [depth] [divide] [threads N] [file FILE | message MESSAGE]" << std::endl;
+            return -1;
+        }
+    }
+    if (depth < 1 || threads < 1)
+    {
+        std::cerr << "Depth and number of threads must be at least 1" << std::endl;
+        return -1;
+    }
+
+    // Read the position, from the command line or from the state file
+    if (message.empty())
+    {
+        std::ifstream input(file.c_str());
+        if (!std::getline(input, message))
+        {
+            std::cerr << "Could not read a state from '" << file << "'" << std::endl;
+            return -1;
+        }
+    }
+    checkers::GameState root(message);
+    std::cerr << root.toString(root.getNextPlayer()) << std::endl;
+
+    checkers::Move moves[checkers::GameState::cMaxMoves];
+    int num_moves = root.findPossibleMoves(moves);
+    std::vector<uint64_t> move_nodes(num_moves, 0);
+
+    // Root moves are handed out to the threads one at a time
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::atomic<int> next_move(0);
+    auto worker = [&]()
+    {
+        checkers::GameState state = root;
+        for (int m = next_move++; m < num_moves; m = next_move++)
+        {
+            if (depth == 1)
+            {
+                move_nodes[m] = 1;
+                continue;
+            }
+            checkers::GameState::Undo undo;
+            state.makeMove(moves[m], undo);
+            move_nodes[m] = perft(state, depth - 1);
+            state.unmakeMove(moves[m], undo);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t)
+        pool.push_back(std::thread(worker));
+    worker();
+    for (unsigned t = 0; t < pool.size(); ++t)
+        pool[t].join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t nodes = 0;
+    for (int m = 0; m < num_moves; ++m)
+    {
+        if (divide)
+            std::cout << moves[m].toMessage() << " " << move_nodes[m] << std::endl;
+        nodes += move_nodes[m];
+    }
+
+    std::cout << "depth " << depth << " nodes " << nodes << " time " << seconds << " s";
+    if (seconds > 0)
+        std::cout << " nps " << (uint64_t)(nodes / seconds);
+    std::cout << std::endl;
+}
@@ -0,0 +1,147 @@
+#include "transposition.hpp"
+#include <cstring>
+
+namespace checkers
+{
+
+TranspositionTable::TranspositionTable(std::size_t pMegabytes)
+    :   mMask(0)
+    ,   mGeneration(0)
+    ,   mEpoch(0)
+{
+    resize(pMegabytes);
+}
+
+void TranspositionTable::resize(std::size_t pMegabytes)
+{
+    // Use the largest power of two number of buckets that fits
+    std::size_t lBuckets = 1;
+    while (lBuckets * 2 * sizeof(Bucket) <= pMegabytes * 1024 * 1024)
+        lBuckets *= 2;
+
+    mBuckets.reset(new Bucket[lBuckets]);
+    mMask = lBuckets - 1;
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    // An empty slot is all zeros, which reads as an entry without a bound
+    for (uint64_t i = 0; i <= mMask; ++i)
+    {
+        for (int j = 0; j < cBucketSize; ++j)
+        {
+            Slot &lSlot = mBuckets[i].mSlots[j];
+            lSlot.mCheck.store(0, std::memory_order_relaxed);
+            lSlot.mScore.store(0, std::memory_order_relaxed);
+            lSlot.mMove.store(0, std::memory_order_relaxed);
+            lSlot.mData.store(0, std::memory_order_relaxed);
+        }
+    }
+    mGeneration = 0;
+    mEpoch = 0;
+}
+
+void TranspositionTable::newSearch()
+{
+    ++mGeneration;
+}
+
+void TranspositionTable::forget()
+{
+    // Entries stored before the epoch wrapped around would be found again
+    if (++mEpoch == 0)
+        clear();
+}
+
+/*
+ * The data word holds the depth in bits 0-7, the bound in bits 8-15, the
+ * generation in bits 16-23 and the epoch in bits 24-55.
+ */
+bool TranspositionTable::load(const Slot &pSlot, Entry &pEntry) const
+{
+    uint64_t lScore = pSlot.mScore.load(std::memory_order_relaxed);
+    uint64_t lMove = pSlot.mMove.load(std::memory_order_relaxed);
+    uint64_t lData = pSlot.mData.load(std::memory_order_relaxed);
+    uint64_t lCheck = pSlot.mCheck.load(std::memory_order_relaxed);
+
+    pEntry.mKey = lCheck ^ lScore ^ lMove ^ lData;
+    memcpy(&pEntry.mScore, &lScore, sizeof(pEntry.mScore));
+    pEntry.mMove = lMove;
+    pEntry.mDepth = (int8_t)(lData & 0xFF);
+    pEntry.mBound = (lData >> 8) & 0xFF;
+    pEntry.mGeneration = (lData >> 16) & 0xFF;
+    return pEntry.mBound != BOUND_NONE && (uint32_t)(lData >> 24) == mEpoch;
+}
+
+bool TranspositionTable::probe(uint64_t pKey, Entry &pEntry)
+{
+    const Bucket &lBucket = mBuckets[pKey & mMask];
+    for (int i = 0; i < cBucketSize; ++i)
+    {
+        if (load(lBucket.mSlots[i], pEntry) && pEntry.mKey == pKey)
+            return true;
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t pKey, int pDepth, double pScore, Bound pBound, const Move &pMove)
+{
+    Bucket &lBucket = mBuckets[pKey & mMask];
+
+    // The first entry keeps the deepest result of the current search,
+    // everything else goes to the second one (torn entries count as empty)
+    Entry lDeepest;
+    Slot *lSlot = &lBucket.mSlots[1];
+    if (!load(lBucket.mSlots[0], lDeepest) || lDeepest.mKey == pKey || lDeepest.mGeneration != mGeneration ||
+        pDepth >= lDeepest.mDepth)
+        lSlot = &lBucket.mSlots[0];
+
+    // Keep the old best move if this search didn't find one
+    uint64_t lMove = packMove(pMove);
+    Entry lOld;
+    if (lMove == 0 && load(*lSlot, lOld) && lOld.mKey == pKey)
+        lMove = lOld.mMove;
+
+    uint64_t lScore;
+    memcpy(&lScore, &pScore, sizeof(lScore));
+    uint64_t lData = (uint64_t)(uint8_t)pDepth | ((uint64_t)pBound << 8) | ((uint64_t)mGeneration << 16) |
+                     ((uint64_t)mEpoch << 24);
+
+    lSlot->mCheck.store(pKey ^ lScore ^ lMove ^ lData, std::memory_order_relaxed);
+    lSlot->mScore.store(lScore, std::memory_order_relaxed);
+    lSlot->mMove.store(lMove, std::memory_order_relaxed);
+    lSlot->mData.store(lData, std::memory_order_relaxed);
+}
+
+/*
+ * Packed moves hold the number of squares in bits 0-3, a jump flag in bit 4
+ * and 5 bits per square from bit 5 on, which leaves room for 11 squares.
+ */
+uint64_t TranspositionTable::packMove(const Move &pMove)
+{
+    if ((!pMove.isNormal() && !pMove.isJump()) || pMove.length() > 11)
+        return 0;
+
+    uint64_t lPacked = pMove.length() | (pMove.isJump() ? 0x10 : 0);
+    for (unsigned i = 0; i < pMove.length(); ++i)
+        lPacked |= (uint64_t)pMove[i] << (5 + 5 * i);
+    return lPacked;
+}
+
+Move TranspositionTable::unpackMove(uint64_t pPacked)
+{
+    int lLength = pPacked & 0xF;
+    if (lLength < 2)
+        return Move(Move::MOVE_NULL);
+
+    uint8_t lSquares[Move::cMaxLength];
+    for (int i = 0; i < lLength; ++i)
+        lSquares[i] = (pPacked >> (5 + 5 * i)) & 0x1F;
+
+    if (pPacked & 0x10)
+        return Move(lSquares, lLength);
+    return Move(lSquares[0], lSquares[1]);
+}
+
+/*namespace checkers*/ }
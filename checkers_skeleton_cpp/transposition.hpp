@@ -0,0 +1,123 @@
+#ifndef _CHECKERS_TRANSPOSITION_HPP_
+#define _CHECKERS_TRANSPOSITION_HPP_
+
+#include "move.hpp"
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace checkers
+{
+
+/**
+ * A fixed-size hash table of search results, indexed by GameState::getHash()
+ *
+ * Each bucket holds two entries: the first keeps the deepest result stored
+ * in the bucket during the current search, the second is always replaced.
+ *
+ * Several search threads can share one table without locks. An entry is
+ * stored as four atomic words, the first of which is the key xor-ed with
+ * the other three; an entry torn by two concurrent stores (or read while
+ * it is being stored) fails that check and is not found by probe().
+ *
+ * forget() empties the table at once, which lets a small table serve one
+ * short search after another (see Player::SearchThread::taskTables).
+ */
+class TranspositionTable
+{
+public:
+    static const std::size_t cDefaultMegabytes = 64;
+
+    ///how the stored score relates to the true value of the position
+    enum Bound
+    {
+        BOUND_NONE  = 0,    ///< empty entry
+        BOUND_UPPER = 1,    ///< the search failed low, the value is at most the score
+        BOUND_LOWER = 2,    ///< the search failed high, the value is at least the score
+        BOUND_EXACT = 3     ///< the score is the value of the position
+    };
+
+    ///a stored search result
+    struct Entry
+    {
+        uint64_t mKey;          ///< full hash of the position
+        double mScore;
+        uint64_t mMove;         ///< best move, packed with packMove()
+        int8_t mDepth;          ///< remaining depth of the search that produced it
+        uint8_t mBound;         ///< a Bound
+        uint8_t mGeneration;    ///< the search (call to newSearch()) that stored it
+
+        ///returns the best move of the entry (a null move if there is none)
+        Move getMove() const    {    return unpackMove(mMove);    }
+    };
+
+    ///creates a table using about \p pMegabytes of memory
+    explicit TranspositionTable(std::size_t pMegabytes = cDefaultMegabytes);
+
+    ///changes the size of the table to about \p pMegabytes, clearing it
+    void resize(std::size_t pMegabytes);
+
+    ///removes all entries
+    void clear();
+
+    ///starts a new search: older entries become preferred for replacement
+    void newSearch();
+
+    ///removes all entries like clear(), but at once: the entries stored so far are only marked as forgotten
+    void forget();
+
+    /**
+     * Looks up the position with hash \p pKey
+     *
+     * \param pKey the hash of the position
+     * \param pEntry receives the entry if found
+     * \return true if the position was found
+     */
+    bool probe(uint64_t pKey, Entry &pEntry);
+
+    /**
+     * Stores a search result
+     *
+     * \param pKey the hash of the position
+     * \param pDepth the remaining depth that was searched
+     * \param pScore the score found
+     * \param pBound how \p pScore relates to the value of the position
+     * \param pMove the best move found, or a null move
+     */
+    void store(uint64_t pKey, int pDepth, double pScore, Bound pBound, const Move &pMove);
+
+    ///packs a normal move or jump into 64 bits (0 for other moves)
+    static uint64_t packMove(const Move &pMove);
+    ///unpacks a move packed with packMove
+    static Move unpackMove(uint64_t pPacked);
+
+private:
+    static const int cBucketSize = 2;
+
+    ///an entry as it is stored in the table
+    struct Slot
+    {
+        std::atomic<uint64_t> mCheck;   ///< key xor the three words below
+        std::atomic<uint64_t> mScore;   ///< bits of the double score
+        std::atomic<uint64_t> mMove;
+        std::atomic<uint64_t> mData;    ///< depth, bound, generation and epoch, see load()
+    };
+
+    struct alignas(64) Bucket
+    {
+        Slot mSlots[cBucketSize];
+    };
+
+    ///reads \p pSlot into \p pEntry, returns false if it is empty, torn or forgotten
+    bool load(const Slot &pSlot, Entry &pEntry) const;
+
+    std::unique_ptr<Bucket[]> mBuckets;
+    uint64_t mMask;
+    uint8_t mGeneration;
+    uint32_t mEpoch;    ///< calls to forget() since the last clear()
+};
+
+/*namespace checkers*/ }
+
+#endif